@@ -61,14 +61,15 @@ struct Context {
     uint64_t x30;
   };
 
-  void* translation_table;
+  void* translation_table;        // TTBR1 tagged by ASID
+  void* lower_translation_table;  // TTBR0
   void* elr;
   Spsr spsr;
   void* sp;
   Registers registers;
 };
 
-static_assert(sizeof(Context) == ((31 * 8) + (4 * 8)));
+static_assert(sizeof(Context) == ((31 * 8) + (5 * 8)));
 
 }  // namespace arm64
 }  // namespace arch
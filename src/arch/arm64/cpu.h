@@ -0,0 +1,137 @@
+/*=============================================================================
+Project Z - Operating system for ARM processors
+Copyright (C) 2018 Vladyslav Samodelok <vladfux4@gmail.com>
+All rights reserved.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+=============================================================================*/
+#ifndef ARCH_ARM64_CPU_H_
+#define ARCH_ARM64_CPU_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace arch {
+namespace arm64 {
+
+/**
+ * @brief The Cpu class
+ */
+class Cpu {
+ public:
+  /**
+   * @brief Get index of the core which executes the code
+   */
+  __attribute__((always_inline)) static size_t CoreId() {
+    uint64_t mpidr;
+    asm volatile("mrs %0, mpidr_el1" : "=r"(mpidr));
+    return (mpidr & 0x3);
+  }
+
+  /**
+   * @brief Mask IRQ of the core
+   *
+   * @return previous interrupt mask state
+   */
+  __attribute__((always_inline)) static uint64_t SaveIrq() {
+    uint64_t daif;
+    asm volatile(
+        "mrs %0, daif\n"
+        "msr daifset, #2" : "=r"(daif) :: "memory");
+    return daif;
+  }
+
+  /**
+   * @brief Restore interrupt mask state saved by SaveIrq
+   */
+  __attribute__((always_inline)) static void RestoreIrq(const uint64_t daif) {
+    asm volatile("msr daif, %0" ::"r"(daif) : "memory");
+  }
+
+  /**
+   * @brief Set data of the core which executes the code
+   */
+  __attribute__((always_inline)) static void SetLocal(void* data) {
+    asm volatile("msr tpidr_el1, %0" ::"r"(data) : "memory");
+  }
+
+  /**
+   * @brief Get data of the core which executes the code
+   */
+  __attribute__((always_inline)) static void* Local() {
+    void* data;
+    asm volatile("mrs %0, tpidr_el1" : "=r"(data));
+    return data;
+  }
+
+  /**
+   * @brief Wake cores waiting in WFE
+   */
+  __attribute__((always_inline)) static void SendEvent() {
+    asm volatile("sev" ::: "memory");
+  }
+
+  /**
+   * @brief Read virtual count of the system counter
+   */
+  __attribute__((always_inline)) static uint64_t Counter() {
+    uint64_t value;
+    asm volatile("isb; mrs %0, cntvct_el0" : "=r"(value));
+    return value;
+  }
+
+  /**
+   * @brief Read frequency of the system counter in Hz
+   */
+  __attribute__((always_inline)) static uint64_t CounterFrequency() {
+    uint64_t value;
+    asm volatile("mrs %0, cntfrq_el0" : "=r"(value));
+    return value;
+  }
+
+  /**
+   * @brief Clean and invalidate data cache lines of range to the point of
+   *        coherency
+   */
+  static void CleanToPoc(const volatile void* begin, const size_t length) {
+    auto line = (reinterpret_cast<uintptr_t>(begin) & ~(kCacheLine - 1));
+    const auto end = (reinterpret_cast<uintptr_t>(begin) + length);
+    for (; line < end; line += kCacheLine) {
+      asm volatile("dc civac, %0" ::"r"(line) : "memory");
+    }
+
+    asm volatile("dsb sy" ::: "memory");
+  }
+
+  /**
+   * @brief Invalidate data cache lines of range to the point of coherency
+   *
+   * Lines are dropped without write back, the range must cover whole lines.
+   */
+  static void InvalidateToPoc(const volatile void* begin,
+                              const size_t length) {
+    auto line = (reinterpret_cast<uintptr_t>(begin) & ~(kCacheLine - 1));
+    const auto end = (reinterpret_cast<uintptr_t>(begin) + length);
+    for (; line < end; line += kCacheLine) {
+      asm volatile("dc ivac, %0" ::"r"(line) : "memory");
+    }
+
+    asm volatile("dsb sy" ::: "memory");
+  }
+
+  static constexpr size_t kCacheLine = 64;
+};
+
+}  // namespace arm64
+}  // namespace arch
+
+#endif  // ARCH_ARM64_CPU_H_
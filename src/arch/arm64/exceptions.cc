@@ -18,6 +18,9 @@ GNU General Public License for more details.
 #include <cstdint>
 
 #include "arch/arm64/exceptions.h"
+#include "arch/arm64/mm/fault.h"
+#include "arch/arm64/mm/mmu.h"
+#include "arch/arm64/system.h"
 #include "kernel/kernel.h"
 #include "kernel/logger.h"
 
@@ -40,7 +43,16 @@ kernel::scheduler::Process::Context* kernel_get_current_context() {
 
 kernel::scheduler::Process::Context* kernel_get_context_to_switch() {
   auto* process = kernel::Kernel::StaticScheduler::Value().ProcessToSwitch();
-  return (process == nullptr) ? nullptr : process->GetContext();
+  if (process == nullptr) {
+    return nullptr;
+  }
+
+  // ASID is refreshed on every switch, stale one can be reallocated
+  auto* context = process->GetContext();
+  context->translation_table = process->AddressSpace().HigherTtbr();
+  context->lower_translation_table = process->AddressSpace().LowerTtbr();
+  arch::arm64::mm::MMU::ParkLowerTable();
+  return context;
 }
 }
 
@@ -48,16 +60,36 @@ namespace arch {
 namespace arm64 {
 
 Exceptions::Exceptions() {
-  asm volatile("msr	vbar_el1, %0" ::"r"(&exception_vectors));
+  Install();
 
   StaticInterface::Make(*this);
 }
 
+void Exceptions::Install() {
+  asm volatile("msr	vbar_el1, %0" ::"r"(&exception_vectors));
+  asm volatile("isb");
+}
+
 void Exceptions::EnableIrq() { asm volatile("msr daifclr, #2"); }
 
 void Exceptions::DisableIrq() { asm volatile("msr daifset, #2"); }
 
 uint64_t Exceptions::HandleSync() {
+  sys::SyndromeRegister esr;
+  esr.ReadEl1();
+  const auto ec = esr.Get<sys::SyndromeRegister::EC>();
+
+  if (mm::Fault::IsAbort(ec)) {
+    HandleAbort();
+    return KERNEL_EXCEPTION_HANDLE_NONE;
+  }
+
+  if (sys::ExceptionClass::SVC != ec) {
+    LOG(ERROR) << "Unhandled sync exception, ESR: " << esr.value;
+    while (true) {
+    }
+  }
+
   LOG(INFO) << "SVC";
   kernel::Kernel::StaticSupervisor::Value().Handle();
 
@@ -69,9 +101,24 @@ uint64_t Exceptions::HandleSync() {
   return KERNEL_EXCEPTION_HANDLE_NONE;
 }
 
+void Exceptions::HandleAbort() {
+  const auto fault = mm::Fault::Read();
+  LOG(DEBUG) << "Abort at: " << fault.address
+             << " type: " << static_cast<uint64_t>(fault.type)
+             << " level: " << static_cast<uint64_t>(fault.level)
+             << " write: " << fault.write;
+
+  // handled fault returns to the faulting instruction
+  if (!kernel::Kernel::StaticMemory::Value().HandleFault(fault)) {
+    LOG(ERROR) << "Unhandled abort at: " << fault.address;
+    while (true) {
+    }
+  }
+}
+
 uint64_t Exceptions::HandleIrq() {
   LOG(INFO) << "IRQ";
-  kernel::Kernel::StaticSysTimer::Value().Tick();
+  kernel::Cpus::Local().timer->Tick();
 
   auto& scheduler = kernel::Kernel::StaticScheduler::Value();
   if (scheduler.CurrentProcess() != scheduler.ProcessToSwitch()) {
@@ -32,11 +32,19 @@ class Exceptions {
 
   Exceptions();
 
+  /**
+   * @brief Set vectors of the core which executes the code
+   */
+  void Install();
+
   uint64_t HandleSync();
   uint64_t HandleIrq();
 
   void EnableIrq();
   void DisableIrq();
+
+ private:
+  void HandleAbort();
 };
 
 }  // namespace arm64
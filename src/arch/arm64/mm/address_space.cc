@@ -15,97 +15,252 @@ GNU General Public License for more details.
 
 =============================================================================*/
 #include "arch/arm64/mm/address_space.h"
+#include "arch/arm64/cpu.h"
+#include "arch/arm64/mm/at.h"
+#include "arch/arm64/mm/tlb.h"
+#include "arch/arm64/mutex.h"
+#include "kernel/hal/mutex_base.h"
 
 namespace arch {
 namespace arm64 {
 namespace mm {
 
+namespace {
+
+using AsidsLock = kernel::hal::MutexBase<arch::arm64::Mutex>;
+
+AddressSpace::Asids asids;
+// taken on the context switch, so IRQ is masked while it is held
+AsidsLock asids_lock;
+
+}  // namespace
+
+AddressSpace::~AddressSpace() {
+  const uint16_t asid = Asids::Value(asid_);
+  kernel::hal::IrqSaveGuard<AsidsLock> guard(asids_lock);
+  if (asids.Release(asid_)) {
+    Tlb::InvalidateAsid(asid);
+  }
+}
+
+void* AddressSpace::LowerTtbr() {
+  if (lower_table_) {
+    return lower_table_->GetBase();
+  }
+
+  return KernelTtbr();
+}
+
+void* AddressSpace::KernelTtbr() {
+  const bool kernel_table = ((nullptr != kernel_) && kernel_->lower_table_);
+  return kernel_table ? kernel_->lower_table_->GetBase() : nullptr;
+}
+
+void* AddressSpace::HigherTtbr() {
+  {
+    kernel::hal::IrqSaveGuard<AsidsLock> guard(asids_lock);
+    if (asids.Acquire(asid_, Cpu::CoreId())) {
+      LOG(DEBUG) << "ASID generation: " << asids.Generation();
+      Tlb::InvalidateAll();
+    }
+  }
+
+  const uint64_t base =
+      higher_table_ ? reinterpret_cast<uint64_t>(higher_table_->GetBase()) : 0;
+  return reinterpret_cast<void*>(
+      base | (static_cast<uint64_t>(Asids::Value(asid_)) << 48));
+}
+
 void AddressSpace::MapRegion(
     void* begin, kernel::mm::PagedRegion::Sptr& region,
     const kernel::mm::Region::Attributes& attr) {
+  using Page = kernel::mm::PagedRegion::Page;
+
   auto table = ChooseTable(begin, region->Length());
-  auto& pages = region->Pages();
-  auto address = reinterpret_cast<kernel::mm::PagedRegion::Page*>(begin);
-
-  for (auto it = pages.Begin(); it != pages.End(); it++, address++) {
-    LOG(DEBUG) << "map page v: " << address << " -> p: " << it.Value();
-
-    TranslationTable::EntryParameters params = {
-      AddressSpace::TranslationTable::BlockSize::_4KB,
-      attr.mem_attr,
-      attr.s2ap,
-      attr.sh,
-      attr.af,
-      attr.contiguous,
-      attr.xn
-    };
-    table->Map(address, reinterpret_cast<void*>(it.Value()), params);
+  auto& blocks = region->Blocks();
+  auto address = reinterpret_cast<Page*>(begin);
+
+  const auto params = Parameters(begin, attr);
+
+  // physically contiguous blocks are merged into one run, so the run can
+  // be mapped by bigger block descriptors
+  Page* run = nullptr;
+  size_t run_count = 0;
+  for (auto it = blocks.Begin(); it != blocks.End(); it++) {
+    Page* page = it.Value().begin;
+    const size_t count = it.Value().Count();
+
+    if ((0 != run_count) && (page == (run + run_count))) {
+      run_count += count;
+      continue;
+    }
+
+    if (0 != run_count) {
+      LOG(DEBUG) << "map run v: " << address << " -> p: " << run
+                 << " pages: " << run_count;
+      table->MapRange(address, run, (run_count * sizeof(Page)), params);
+      address += run_count;
+    }
+
+    run = page;
+    run_count = count;
+  }
+
+  if (0 != run_count) {
+    LOG(DEBUG) << "map run v: " << address << " -> p: " << run
+               << " pages: " << run_count;
+    table->MapRange(address, run, (run_count * sizeof(Page)), params);
   }
 }
 
 void AddressSpace::MapRegion(
     void* begin, kernel::mm::DirectRegion::Sptr& region,
     const kernel::mm::Region::Attributes& attr) {
+  constexpr size_t kPageBytes = (1ULL << 12);
   auto table = ChooseTable(begin, region->Length());
-  bool valid_region = false;
-  TranslationTable::BlockSize block_size = TranslationTable::BlockSize::_4KB;
-  size_t block_length = 0;
-  size_t count = 0;
 
-  if ((reinterpret_cast<size_t>(region->Begin()) % (1ULL << 12)) != 0) {
+  if ((reinterpret_cast<size_t>(region->Begin()) % kPageBytes) != 0) {
     LOG(ERROR) << "Not alligned region begin address: " << region->Begin();
     return;
   }
 
-  if ((region->Length() % (1ULL << 12)) == 0) {
-    block_size = TranslationTable::BlockSize::_4KB;
-    block_length = (1ULL << 12);
-    count = region->Length() / (1ULL << 12);
-    valid_region = true;
+  if ((region->Length() % kPageBytes) != 0) {
+    LOG(ERROR) << "Wrong region length: " << region->Length();
+    return;
   }
 
-  if ((region->Length() % (1ULL << 21)) == 0) {
-    block_size = TranslationTable::BlockSize::_2MB;
-    block_length = (1ULL << 21);
-    count = region->Length() / (1ULL << 21);
-    valid_region = true;
+  const auto params = Parameters(begin, attr);
+
+  table->MapRange(begin, region->Begin(), region->Length(), params);
+
+  LOG(DEBUG) << "map region v: " << begin << " -> p: " << region->Begin();
+}
+
+void AddressSpace::MapPage(void* begin, void* page,
+                           const kernel::mm::Region::Attributes& attr) {
+  constexpr size_t kPageBytes = (1ULL << 12);
+  auto table = ChooseTable(begin, kPageBytes);
+  table->MapRange(begin, page, kPageBytes, Parameters(begin, attr));
+  Tlb::SyncTables();
+
+  LOG(DEBUG) << "map page v: " << begin << " -> p: " << page;
+}
+
+void AddressSpace::RemapPage(void* begin, void* page,
+                             const kernel::mm::Region::Attributes& attr) {
+  constexpr size_t kPageBytes = (1ULL << 12);
+  UnmapRange(begin, kPageBytes);
+  MapPage(begin, page, attr);
+}
+
+void AddressSpace::UnmapRange(void* begin, const size_t length) {
+  auto table = ChooseTable(begin, length);
+  Invalidate(table, table->UnmapRange(begin, length));
+
+  LOG(DEBUG) << "unmap range v: " << begin << " length: " << length;
+}
+
+void AddressSpace::Protect(void* begin, const size_t length,
+                           const kernel::mm::Region::Attributes& attr) {
+  auto table = ChooseTable(begin, length);
+
+  const auto params = Parameters(begin, attr);
+
+  Invalidate(table, table->Protect(begin, length, params));
+
+  LOG(DEBUG) << "protect range v: " << begin << " length: " << length;
+}
+
+AddressSpace::TranslationTable::EntryParameters AddressSpace::Parameters(
+    void* address, const kernel::mm::Region::Attributes& attr) const {
+  // only the kernel lower table is shared by all spaces, translations of
+  // the space own tables are cached by its ASID
+  const bool higher = (reinterpret_cast<size_t>(address) >= kHigherStart);
+  const bool global = (!higher && ((nullptr == kernel_) || (this == kernel_)));
+  return {TranslationTable::BlockSize::_4KB,
+          attr.mem_attr,
+          attr.s2ap,
+          attr.sh,
+          attr.af,
+          attr.contiguous,
+          attr.xn,
+          global ? NG::GLOBAL : NG::NOT_GLOBAL};
+}
+
+void AddressSpace::Invalidate(const TranslationTable* table,
+                              const TranslationTable::Change& change) {
+  if (change.Empty()) {
+    return;
   }
 
-  if ((region->Length() % (1ULL << 30)) == 0) {
-    block_size = TranslationTable::BlockSize::_1GB;
-    block_length = (1ULL << 30);
-    count = region->Length() / (1ULL << 30);
-    valid_region = true;
+  // global kernel translations are invalidated for all ASIDs
+  uint16_t asid = 0;
+  if ((table == higher_table_.Get()) ||
+      ((table == lower_table_.Get()) && (this != kernel_))) {
+    // space which never ran has nothing cached
+    if (Asids::kNone == asid_) {
+      return;
+    }
+    asid = Asids::Value(asid_);
   }
 
-  if (!valid_region) {
-    LOG(ERROR) << "Wrong region length: " << region->Length();
-    return;
+  // freed or split tables can be held by cached walks, so upper levels
+  // are invalidated too
+  Tlb::InvalidateRange(reinterpret_cast<void*>(change.begin),
+                       (change.end - change.begin), !change.tables, asid);
+}
+
+void AddressSpace::Flush(void* context, const TranslationTable& table,
+                         const TranslationTable::Change& change) {
+  static_cast<AddressSpace*>(context)->Invalidate(&table, change);
+}
+
+AddressSpace::TranslationTable* AddressSpace::GetLowerTable() {
+  if (!lower_table_) {
+    GetTable(lower_table_);
+    if ((nullptr != kernel_) && (this != kernel_) && kernel_->lower_table_) {
+      lower_table_->Share(*kernel_->lower_table_);
+      // own lower translations are tagged by the ASID of TTBR1
+      GetHigherTable();
+    }
   }
 
-  for (size_t i = 0; i < count; i++) {
-    const size_t offset = (i * block_length);
-    void* p_address =
-        reinterpret_cast<void*>(
-          offset + reinterpret_cast<size_t>(region->Begin()));
-    void* v_address =
-        reinterpret_cast<void*>(
-          offset + reinterpret_cast<size_t>(begin));
-
-    TranslationTable::EntryParameters params = {
-      block_size,
-      attr.mem_attr,
-      attr.s2ap,
-      attr.sh,
-      attr.af,
-      attr.contiguous,
-      attr.xn
-    };
-
-    table->Map(v_address, p_address, params);
+  return lower_table_.Get();
+}
+
+bool AddressSpace::Translate(const void* address, size_t& physical) {
+  auto table = FindTable(address);
+  if (nullptr == table) {
+    return false;
   }
 
-  LOG(DEBUG) << "map region v: " << begin << " -> p: " << region->Begin();
+  const bool higher = (reinterpret_cast<size_t>(address) >= kHigherStart);
+  const uint64_t selected = higher ? AddressTranslation::HigherBase()
+                                   : AddressTranslation::LowerBase();
+  if (reinterpret_cast<uint64_t>(table->GetBase()) == selected) {
+    uint64_t output = 0;
+    const bool mapped = AddressTranslation::Stage1Read(address, output);
+    physical = output;
+    return mapped;
+  }
+
+  const auto out = table->Translate(address);
+  physical = out.address;
+  return out.Valid();
+}
+
+AddressSpace::TranslationTable* AddressSpace::FindTable(const void* address) {
+  if (reinterpret_cast<size_t>(address) >= kHigherStart) {
+    return higher_table_.Get();
+  }
+
+  if (lower_table_) {
+    return lower_table_.Get();
+  }
+
+  return ((nullptr != kernel_) && kernel_->lower_table_)
+             ? kernel_->lower_table_.Get()
+             : nullptr;
 }
 
 AddressSpace::TranslationTable* AddressSpace::ChooseTable(
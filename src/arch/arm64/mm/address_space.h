@@ -23,6 +23,7 @@ GNU General Public License for more details.
 #include <type_traits>
 #include <utility>
 
+#include "arch/arm64/mm/asid.h"
 #include "arch/arm64/mm/translation_table.h"
 #include "kernel/logger.h"
 #include "kernel/config.h"
@@ -45,11 +46,94 @@ class AddressSpace {
   static constexpr size_t kHigherStart = 0xFFFFFF8000000000;
   static constexpr size_t kHigherEnd = 0xFFFFFFFFFFFFF000;
 
-  AddressSpace() : lower_table_(nullptr), higher_table_(nullptr) {}
+  using Asids = AsidAllocator<kernel::KERNEL_ASID_BITS, kernel::KERNEL_CPU_COUNT>;
+
+  AddressSpace()
+      : lower_table_(nullptr), higher_table_(nullptr), asid_(Asids::kNone) {}
+  ~AddressSpace();
 
   void MapRegion(void* begin, kernel::mm::PagedRegion::Sptr& region, const kernel::mm::Region::Attributes& attr);
   void MapRegion(void* begin, kernel::mm::DirectRegion::Sptr& region, const kernel::mm::Region::Attributes& attr);
 
+  /**
+   * @brief Map single page to the unmapped address
+   *
+   * Invalid entries are not cached, so TLB is not invalidated.
+   */
+  void MapPage(void* begin, void* page, const kernel::mm::Region::Attributes& attr);
+
+  /**
+   * @brief Replace translation of mapped page, break-before-make
+   */
+  void RemapPage(void* begin, void* page, const kernel::mm::Region::Attributes& attr);
+
+  /**
+   * @brief Unmap range and invalidate its TLB entries
+   */
+  void UnmapRange(void* begin, const size_t length);
+
+  /**
+   * @brief Change attributes of mapped range and invalidate its TLB entries
+   */
+  void Protect(void* begin, const size_t length, const kernel::mm::Region::Attributes& attr);
+
+  /**
+   * @brief Translate virtual address of the space to physical one
+   *
+   * Selected space is translated by the MMU, other spaces by the table
+   * walk. Returns false if the address is not mapped.
+   */
+  bool Translate(const void* address, size_t& physical);
+
+  /**
+   * @brief Translate range by the table walk, visitor gets physically
+   *        contiguous runs (physical, length)
+   *
+   * Returns false if a part of the range is not mapped.
+   */
+  template <class Visitor>
+  bool TranslateRange(const void* address, const size_t length,
+                      Visitor visitor) {
+    auto table = FindTable(address);
+    auto begin = reinterpret_cast<size_t>(address);
+    const size_t end = (begin + length);
+    size_t run = 0;
+    size_t run_length = 0;
+
+    while (begin < end) {
+      if (nullptr == table) {
+        return false;
+      }
+
+      const auto out = table->Translate(reinterpret_cast<void*>(begin));
+      if (!out.Valid()) {
+        return false;
+      }
+
+      // rest of the leaf entry is contiguous with the translated address
+      const size_t entry_left = (out.bytes - (begin & (out.bytes - 1)));
+      const size_t step = (entry_left < (end - begin)) ? entry_left
+                                                       : (end - begin);
+      if ((0 != run_length) && ((run + run_length) == out.address)) {
+        run_length += step;
+      } else {
+        if (0 != run_length) {
+          visitor(run, run_length);
+        }
+        run = out.address;
+        run_length = step;
+      }
+
+      begin += step;
+    }
+
+    if (0 != run_length) {
+      visitor(run, run_length);
+    }
+
+    return true;
+  }
+
   const TranslationTable* LowerTable() const {
     return lower_table_.Get();
   }
@@ -58,23 +142,64 @@ class AddressSpace {
     return higher_table_.Get();
   }
 
+  /**
+   * @brief Set space which lower table holds the kernel mappings
+   *
+   * Lower tables of other spaces link its root entries, so the kernel
+   * tables are allocated and mapped once.
+   */
+  static void SetKernel(AddressSpace& space) { kernel_ = &space; }
+
+  /**
+   * @brief Get TTBR0 value of the space
+   *
+   * Space without own lower mappings uses the kernel table, own table
+   * relinks the kernel root entries if they were changed.
+   */
+  void* LowerTtbr();
+
+  /**
+   * @brief Get TTBR0 value of the kernel table, it holds only global
+   *        translations, so it can be walked with any ASID
+   */
+  static void* KernelTtbr();
+
+  /**
+   * @brief Get TTBR1 value tagged by ASID of the space
+   *
+   * ASID is allocated on demand and marked active on the current core,
+   * the whole TLB is flushed only when a generation of ASIDs runs out.
+   */
+  void* HigherTtbr();
+
  private:
   using TranslationTableUptr = kernel::mm::UniquePointer<TranslationTable, kernel::mm::SlabAllocator>;
 
   TranslationTable* ChooseTable(void* address, size_t length);
-
-  TranslationTable* GetLowerTable() { return GetTable(lower_table_); }
+  TranslationTable* FindTable(const void* address);
+  TranslationTable::EntryParameters Parameters(
+      void* address, const kernel::mm::Region::Attributes& attr) const;
+  void Invalidate(const TranslationTable* table,
+                  const TranslationTable::Change& change);
+  static void Flush(void* context, const TranslationTable& table,
+                    const TranslationTable::Change& change);
+
+  TranslationTable* GetLowerTable();
   TranslationTable* GetHigherTable() { return GetTable(higher_table_); }
 
   TranslationTable* GetTable(TranslationTableUptr& table) {
     if (!table) {
       table = TranslationTableUptr::Make();
+      table->SetFlush(&AddressSpace::Flush, this);
     }
     return table.Get();
   }
 
   TranslationTableUptr lower_table_;
   TranslationTableUptr higher_table_;
+  uint64_t asid_;
+
+  static inline AddressSpace* kernel_ = nullptr;
 };
 
 }  // namespace mm
@@ -0,0 +1,174 @@
+/*=============================================================================
+Project Z - Operating system for ARM processors
+Copyright (C) 2018 Vladyslav Samodelok <vladfux4@gmail.com>
+All rights reserved.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+=============================================================================*/
+#ifndef ARCH_ARM64_MM_ASID_H_
+#define ARCH_ARM64_MM_ASID_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace arch {
+namespace arm64 {
+namespace mm {
+
+/**
+ * @brief The address space identifier allocator
+ *
+ * Tag holds the ASID in low kBits and the generation above them. When
+ * a generation runs out of ASIDs the next one is started, tags of older
+ * generations become stale and get new ASIDs on the next switch. ASIDs
+ * active on cores are kept through the rollover, so running spaces do
+ * not lose their TLB entries. ASID 0 is never allocated.
+ */
+template <size_t kBits, size_t kCpuCount>
+class AsidAllocator {
+ public:
+  static constexpr uint64_t kCount = (1ULL << kBits);
+  static constexpr uint64_t kMask = (kCount - 1);
+  static constexpr uint64_t kNone = 0;
+
+  constexpr AsidAllocator()
+      : generation_(kCount), hint_(0), used_{{1}}, active_(), reserved_() {}
+
+  /**
+   * @brief Get ASID of the current generation for tag and mark it active
+   *
+   * Returns true if the generation rolled over, then the whole TLB has to
+   * be invalidated before the ASID is used.
+   */
+  bool Acquire(uint64_t& tag, const size_t cpu) {
+    bool rollover = false;
+    if (!Current(tag)) {
+      tag = Allocate(tag, rollover);
+    }
+
+    active_[cpu] = tag;
+    return rollover;
+  }
+
+  /**
+   * @brief Free ASID of tag
+   *
+   * Returns true if translations tagged by the ASID can be in the TLB.
+   */
+  bool Release(uint64_t& tag) {
+    bool cached = Current(tag);
+    for (auto& reserved : reserved_) {
+      if ((kNone != tag) && (reserved == tag)) {
+        reserved = kNone;
+        cached = true;
+      }
+    }
+
+    if (cached) {
+      Clear(Value(tag));
+    }
+
+    tag = kNone;
+    return cached;
+  }
+
+  bool Current(const uint64_t tag) const {
+    return (kNone != tag) && ((tag & ~kMask) == generation_);
+  }
+
+  static uint16_t Value(const uint64_t tag) {
+    return static_cast<uint16_t>(tag & kMask);
+  }
+
+  uint64_t Generation() const { return (generation_ >> kBits); }
+
+ private:
+  static constexpr size_t kWordBits = 64;
+  static constexpr size_t kWords = ((kCount + kWordBits - 1) / kWordBits);
+
+  uint64_t Allocate(const uint64_t tag, bool& rollover) {
+    // ASID which was active on a core during rollover is still owned
+    for (const auto reserved : reserved_) {
+      if ((kNone != tag) && (reserved == tag)) {
+        return (generation_ | Value(tag));
+      }
+    }
+
+    uint64_t asid = Find();
+    if (kNone == asid) {
+      Rollover();
+      rollover = true;
+      asid = Find();
+    }
+
+    Set(asid);
+    hint_ = (asid / kWordBits);
+    return (generation_ | asid);
+  }
+
+  void Rollover() {
+    generation_ += kCount;
+    used_.fill(0);
+    Set(0);
+
+    for (size_t cpu = 0; cpu < kCpuCount; ++cpu) {
+      reserved_[cpu] = active_[cpu];
+      if (kNone != active_[cpu]) {
+        Set(Value(active_[cpu]));
+      }
+    }
+
+    hint_ = 0;
+  }
+
+  uint64_t Find() const {
+    for (size_t i = 0; i < kWords; ++i) {
+      const size_t word = ((hint_ + i) % kWords);
+      uint64_t free = ~used_[word];
+      if ((kWords - 1) == word) {
+        free &= LastWordMask();
+      }
+
+      if (0 != free) {
+        return ((word * kWordBits) + __builtin_ctzll(free));
+      }
+    }
+
+    return kNone;
+  }
+
+  static constexpr uint64_t LastWordMask() {
+    return ((kCount % kWordBits) == 0) ? ~0ULL
+                                       : ((1ULL << (kCount % kWordBits)) - 1);
+  }
+
+  void Set(const uint64_t asid) {
+    used_[asid / kWordBits] |= (1ULL << (asid % kWordBits));
+  }
+
+  void Clear(const uint64_t asid) {
+    used_[asid / kWordBits] &= ~(1ULL << (asid % kWordBits));
+  }
+
+  uint64_t generation_;
+  size_t hint_;
+  std::array<uint64_t, kWords> used_;
+  std::array<uint64_t, kCpuCount> active_;
+  std::array<uint64_t, kCpuCount> reserved_;
+};
+
+}  // namespace mm
+}  // namespace arm64
+}  // namespace arch
+
+#endif  // ARCH_ARM64_MM_ASID_H_
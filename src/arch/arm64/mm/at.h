@@ -0,0 +1,84 @@
+/*=============================================================================
+Project Z - Operating system for ARM processors
+Copyright (C) 2018 Vladyslav Samodelok <vladfux4@gmail.com>
+All rights reserved.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+=============================================================================*/
+#ifndef ARCH_ARM64_MM_AT_H_
+#define ARCH_ARM64_MM_AT_H_
+
+#include <cstdint>
+
+#include "arch/arm64/cpu.h"
+
+namespace arch {
+namespace arm64 {
+namespace mm {
+
+/**
+ * @brief The address translation by the MMU with tables of selected space
+ */
+class AddressTranslation {
+ public:
+  /**
+   * @brief Translate address as EL1 read, returns false on fault
+   *
+   * IRQ is masked, so a handler can not overwrite PAR_EL1 between the
+   * translation and the read of its result.
+   */
+  static bool Stage1Read(const void* address, uint64_t& physical) {
+    uint64_t par;
+    const uint64_t flags = Cpu::SaveIrq();
+    asm volatile(
+        "at s1e1r, %1\n"
+        "isb\n"
+        "mrs %0, par_el1"
+        : "=r"(par)
+        : "r"(address)
+        : "memory");
+    Cpu::RestoreIrq(flags);
+
+    if (0 != (par & kFaultBit)) {
+      return false;
+    }
+
+    physical = ((par & kAddressMask) |
+                (reinterpret_cast<uint64_t>(address) & kPageOffsetMask));
+    return true;
+  }
+
+  static uint64_t LowerBase() {
+    uint64_t value;
+    asm volatile("mrs %0, ttbr0_el1" : "=r"(value));
+    return (value & kTableBaseMask);
+  }
+
+  static uint64_t HigherBase() {
+    uint64_t value;
+    asm volatile("mrs %0, ttbr1_el1" : "=r"(value));
+    return (value & kTableBaseMask);
+  }
+
+ private:
+  static constexpr uint64_t kFaultBit = 0b1;
+  static constexpr uint64_t kAddressMask = 0x0000FFFFFFFFF000ULL;
+  static constexpr uint64_t kPageOffsetMask = 0xFFFULL;
+  // TTBR holds ASID in bits 48-63 and CnP in bit 0
+  static constexpr uint64_t kTableBaseMask = 0x0000FFFFFFFFFFFEULL;
+};
+
+}  // namespace mm
+}  // namespace arm64
+}  // namespace arch
+
+#endif  // ARCH_ARM64_MM_AT_H_
@@ -0,0 +1,52 @@
+/*=============================================================================
+Project Z - Operating system for ARM processors
+Copyright (C) 2018 Vladyslav Samodelok <vladfux4@gmail.com>
+All rights reserved.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+=============================================================================*/
+#ifndef ARCH_ARM64_MM_BOOT_MAP_H_
+#define ARCH_ARM64_MM_BOOT_MAP_H_
+
+/*
+ * Identity map which is built by the boot code before any C++ runs.
+ * The first GB is mapped by 2MB blocks: RAM is normal cacheable memory,
+ * VideoCore memory of the default split is normal non-cacheable, so no
+ * cache line of it is allocated before the kernel maps it, peripherals
+ * are device memory. The second GB holds local peripherals
+ * and is one device block. Values are shared with the assembler, so they
+ * are plain defines, MMU checks them against its own register values.
+ */
+
+#define BOOT_MAP_VC_BASE 0x37000000
+#define BOOT_MAP_DEVICE_BASE 0x3F000000
+#define BOOT_MAP_LOCAL_BASE 0x40000000
+// release addresses of secondary cores polled by the spin-table firmware
+#define BOOT_SPIN_TABLE_BASE 0xD8
+
+// level 2 table descriptor
+#define BOOT_MAP_TABLE 0x3
+// valid block, attr NORMAL, inner shareable, access flag
+#define BOOT_MAP_NORMAL_BLOCK 0x711
+// valid block, attr NORMAL_NC, non-shareable, access flag
+#define BOOT_MAP_NC_BLOCK 0x40D
+// valid block, attr DEVICE_NGNRNE, access flag, PXN and UXN
+#define BOOT_MAP_DEVICE_BLOCK 0x0060000000000401
+
+// MAIR_EL1 value for MemoryAttr indexes
+#define BOOT_MAP_MAIR 0x000000FF440C0400
+// TCR_EL1 value of MMU::Enable with TTBR1 walks disabled
+#define BOOT_MAP_TCR 0x10B5D93519
+// SCTLR_EL1 bits M, A, C, SA, SA0 and I
+#define BOOT_MAP_SCTLR 0x101F
+
+#endif  // ARCH_ARM64_MM_BOOT_MAP_H_
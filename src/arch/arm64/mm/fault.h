@@ -0,0 +1,103 @@
+/*=============================================================================
+Project Z - Operating system for ARM processors
+Copyright (C) 2018 Vladyslav Samodelok <vladfux4@gmail.com>
+All rights reserved.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+=============================================================================*/
+#ifndef ARCH_ARM64_MM_FAULT_H_
+#define ARCH_ARM64_MM_FAULT_H_
+
+#include <cstdint>
+
+#include "arch/arm64/system.h"
+
+namespace arch {
+namespace arm64 {
+namespace mm {
+
+enum class FaultType {
+  ADDRESS_SIZE,
+  TRANSLATION,
+  ACCESS_FLAG,
+  PERMISSION,
+  OTHER,
+};
+
+/**
+ * @brief The decoded instruction or data abort
+ */
+struct Fault {
+  void* address;
+  FaultType type;
+  uint8_t level;
+  bool write;
+  bool instruction;
+
+  static constexpr bool IsAbort(const sys::ExceptionClass ec) {
+    return (sys::ExceptionClass::INSTRUCTION_ABORT_LOWER == ec) ||
+           (sys::ExceptionClass::INSTRUCTION_ABORT == ec) ||
+           (sys::ExceptionClass::DATA_ABORT_LOWER == ec) ||
+           (sys::ExceptionClass::DATA_ABORT == ec);
+  }
+
+  /**
+   * @brief Decode abort from ESR and FAR values
+   *
+   * Fault status code is 0bTTTTLL, where LL is the lookup level
+   */
+  static Fault Decode(const uint64_t esr, const uint64_t far) {
+    using Esr = sys::SyndromeRegister;
+    const uint8_t fsc = Esr::GetValue<Esr::FSC>(esr);
+    const auto ec = Esr::GetValue<Esr::EC>(esr);
+    const bool instruction =
+        (sys::ExceptionClass::INSTRUCTION_ABORT_LOWER == ec) ||
+        (sys::ExceptionClass::INSTRUCTION_ABORT == ec);
+
+    FaultType type = FaultType::OTHER;
+    switch (fsc >> 2) {
+      case 0b0000:
+        type = FaultType::ADDRESS_SIZE;
+        break;
+      case 0b0001:
+        type = FaultType::TRANSLATION;
+        break;
+      case 0b0010:
+        type = FaultType::ACCESS_FLAG;
+        break;
+      case 0b0011:
+        type = FaultType::PERMISSION;
+        break;
+    }
+
+    return {reinterpret_cast<void*>(far), type,
+            static_cast<uint8_t>(fsc & 0b11),
+            !instruction && Esr::GetValue<Esr::WNR>(esr), instruction};
+  }
+
+  /**
+   * @brief Read abort which is being handled
+   */
+  static Fault Read() {
+    sys::SyndromeRegister esr;
+    esr.ReadEl1();
+    uint64_t far;
+    asm volatile("mrs %0, far_el1" : "=r"(far));
+    return Decode(esr.value, far);
+  }
+};
+
+}  // namespace mm
+}  // namespace arm64
+}  // namespace arch
+
+#endif  // ARCH_ARM64_MM_FAULT_H_
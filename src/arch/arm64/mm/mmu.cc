@@ -16,6 +16,8 @@ GNU General Public License for more details.
 =============================================================================*/
 #include "arch/arm64/mm/mmu.h"
 
+#include "arch/arm64/mm/boot_map.h"
+#include "arch/arm64/mm/tlb.h"
 #include "arch/arm64/mm/translation_descriptor.h"
 #include "arch/arm64/system.h"
 #include "kernel/config.h"
@@ -24,63 +26,100 @@ namespace arch {
 namespace arm64 {
 namespace mm {
 
+static_assert((8 == kernel::KERNEL_ASID_BITS) || (16 == kernel::KERNEL_ASID_BITS),
+              "ASID is 8 or 16 bits");
+
+namespace {
+
+constexpr uint64_t kMair =
+    ((0x00ull << (static_cast<std::size_t>(MemoryAttr::DEVICE_NGNRNE) * 8)) |
+     (0x04ull << (static_cast<std::size_t>(MemoryAttr::DEVICE_NGNRE) * 8)) |
+     (0x0cull << (static_cast<std::size_t>(MemoryAttr::DEVICE_GRE) * 8)) |
+     (0x44ull << (static_cast<std::size_t>(MemoryAttr::NORMAL_NC) * 8)) |
+     (0xffull << (static_cast<std::size_t>(MemoryAttr::NORMAL) * 8)));
+
+constexpr auto kTcr = tcr::TcrRegister::MakeValue(
+    tcr::TcrRegister::IPS(tcr::IPS::_32_BIT),
+    tcr::TcrRegister::AS((16 == kernel::KERNEL_ASID_BITS) ? tcr::AS::_16_BIT
+                                                          : tcr::AS::_8_BIT),
+    tcr::TcrRegister::A1(tcr::A1::TTBR1_ASID),
+    tcr::TcrRegister::TG1(tcr::TG1::_4KB),
+    tcr::TcrRegister::SH1(tcr::SH1::INNER_SHAREABLE),
+    tcr::TcrRegister::ORGN1(tcr::ORGN1::WRITE_BACK_CACHEABLE),
+    tcr::TcrRegister::IRGN1(tcr::IRGN1::WRITE_BACK_CACHEABLE),
+    tcr::TcrRegister::EPD1(tcr::EPD1::WALK),
+    tcr::TcrRegister::T1SZ(
+        tcr::TcrRegister::ConvertToTnSZ(kernel::mm::KERNEL_ADDRESS_LENGTH)),
+    tcr::TcrRegister::TG0(tcr::TG0::_4KB),
+    tcr::TcrRegister::SH0(tcr::SH0::INNER_SHAREABLE),
+    tcr::TcrRegister::ORGN0(tcr::ORGN0::WRITE_BACK_CACHEABLE),
+    tcr::TcrRegister::IRGN0(tcr::IRGN0::WRITE_BACK_CACHEABLE),
+    tcr::TcrRegister::EPD0(tcr::EPD0::WALK),
+    tcr::TcrRegister::T0SZ(
+        tcr::TcrRegister::ConvertToTnSZ(kernel::mm::KERNEL_ADDRESS_LENGTH)));
+
+constexpr auto kSctlr = sys::SystemControlRegister::MakeValue(
+    sys::SystemControlRegister::I(true), sys::SystemControlRegister::SA0(true),
+    sys::SystemControlRegister::SA(true), sys::SystemControlRegister::C(true),
+    sys::SystemControlRegister::A(true), sys::SystemControlRegister::M(true));
+
+// boot code enables MMU by the same values, only TTBR1 walks are off
+static_assert(BOOT_MAP_MAIR == kMair, "Boot MAIR differs");
+static_assert(BOOT_MAP_TCR == (kTcr | tcr::TcrRegister::MakeValue(
+                                          tcr::TcrRegister::EPD1(
+                                              tcr::EPD1::GENERATE_FAULT))),
+              "Boot TCR differs");
+static_assert(BOOT_MAP_SCTLR == kSctlr, "Boot SCTLR differs");
+
+}  // namespace
+
 MMU::MMU() : tcr_() {}
 
 void MMU::Enable() {
-  uint64_t r;
-
   asm volatile("dsb sy");
-  // Set mem attr
-  r = ((0x00ull << (static_cast<std::size_t>(MemoryAttr::DEVICE_NGNRNE) * 8)) |
-       (0x04ull << (static_cast<std::size_t>(MemoryAttr::DEVICE_NGNRE) * 8)) |
-       (0x0cull << (static_cast<std::size_t>(MemoryAttr::DEVICE_GRE) * 8)) |
-       (0x44ull << (static_cast<std::size_t>(MemoryAttr::NORMAL_NC) * 8)) |
-       (0xffull << (static_cast<std::size_t>(MemoryAttr::NORMAL) * 8)));
-  asm volatile("msr mair_el1, %0" : : "r"(r));
-
-  constexpr auto trc_value = tcr::TcrRegister::MakeValue(
-      tcr::TcrRegister::IPS(tcr::IPS::_32_BIT),
-      tcr::TcrRegister::TG1(tcr::TG1::_4KB),
-      tcr::TcrRegister::SH1(tcr::SH1::INNER_SHAREABLE),
-      tcr::TcrRegister::ORGN1(tcr::ORGN1::WRITE_BACK_CACHEABLE),
-      tcr::TcrRegister::IRGN1(tcr::IRGN1::WRITE_BACK_CACHEABLE),
-      tcr::TcrRegister::EPD1(tcr::EPD1::WALK),
-      tcr::TcrRegister::T1SZ(
-          tcr::TcrRegister::ConvertToTnSZ(kernel::mm::KERNEL_ADDRESS_LENGTH)),
-      tcr::TcrRegister::TG0(tcr::TG0::_4KB),
-      tcr::TcrRegister::SH0(tcr::SH0::INNER_SHAREABLE),
-      tcr::TcrRegister::ORGN0(tcr::ORGN0::WRITE_BACK_CACHEABLE),
-      tcr::TcrRegister::IRGN0(tcr::IRGN0::WRITE_BACK_CACHEABLE),
-      tcr::TcrRegister::EPD0(tcr::EPD0::WALK),
-      tcr::TcrRegister::T0SZ(
-          tcr::TcrRegister::ConvertToTnSZ(kernel::mm::KERNEL_ADDRESS_LENGTH)));
-  tcr_.Set(trc_value);
+  asm volatile("msr mair_el1, %0" : : "r"(kMair));
+
+  tcr_.Set(kTcr);
   tcr_.FlushToEl1();
 
+  // translations cached with the old control registers are dropped
+  Tlb::InvalidateAll();
+
   // toggle some bits in system control register to enable page translation
-  asm volatile("isb");
   sys::SystemControlRegister scr;
   scr.ReadEl1();
-  constexpr auto crc_value = sys::SystemControlRegister::MakeValue(
-      sys::SystemControlRegister::I(true),
-      sys::SystemControlRegister::SA0(true),
-      sys::SystemControlRegister::SA(true), sys::SystemControlRegister::C(true),
-      sys::SystemControlRegister::A(true), sys::SystemControlRegister::M(true));
-  scr.Set(crc_value);
+  scr.Set(kSctlr);
   scr.FlushToEl1();
   asm volatile("isb");
 }
 
 void MMU::SelectAddressSpace(AddressSpace& space) {
-  auto lower_table = space.LowerTable();
-  if (lower_table) {
-    SetLowerTable(lower_table->GetBase());
+  // ASID of TTBR1 tags the lower translations too, so TTBR0 is switched
+  // after it and no TLB invalidation is needed
+  ParkLowerTable();
+  if (space.HigherTable()) {
+    SetHigherTable(space.HigherTtbr());
+    asm volatile("isb" ::: "memory");
   }
 
-  auto higher_table = space.HigherTable();
-  if (higher_table) {
-    SetHigherTable(higher_table->GetBase());
+  auto lower_table = space.LowerTtbr();
+  if (nullptr != lower_table) {
+    SetLowerTable(lower_table);
   }
+  asm volatile("isb" ::: "memory");
+}
+
+void MMU::LeaveBootMap(AddressSpace& kernel_space) {
+  asm volatile(
+      "dsb ishst\n"
+      "msr ttbr0_el1, %0\n"
+      "isb\n"
+      "tlbi vmalle1\n"
+      "dsb ish\n"
+      "isb" ::"r"(kernel_space.LowerTtbr())
+      : "memory");
+
+  SelectAddressSpace(kernel_space);
 }
 
 }  // namespace mm
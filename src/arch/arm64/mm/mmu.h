@@ -42,20 +42,41 @@ class MMU {
   inline void SetLowerTable(void* address) { SetTTBR0(address); }
   inline void SetHigherTable(void* address) { SetTTBR1(address); }
 
+  /**
+   * @brief Point TTBR0 to the kernel table before ASID changes, the lower
+   *        table of the old space must not be walked with the new ASID
+   */
+  static void ParkLowerTable() {
+    void* kernel_table = AddressSpace::KernelTtbr();
+    if (nullptr != kernel_table) {
+      SetTTBR0(kernel_table);
+      asm volatile("isb" ::: "memory");
+    }
+  }
+
   void SelectAddressSpace(AddressSpace& address_space);
 
+  /**
+   * @brief Replace the boot map of the core by the kernel space
+   *
+   * Boot map blocks and kernel pages translate the same addresses with
+   * other sizes and attributes, so the TLB of the core is invalidated
+   * right after TTBR0 is switched, before any other memory access.
+   */
+  void LeaveBootMap(AddressSpace& kernel_space);
+
  private:
   /**
    * @brief Set 0 translation table address
    */
-  __attribute__((always_inline)) void SetTTBR0(void* address) {
+  __attribute__((always_inline)) static void SetTTBR0(void* address) {
     asm volatile("msr ttbr0_el1, %0" : : "r"(address));
   }
 
   /**
    * @brief Set 1 translation table address
    */
-  __attribute__((always_inline)) void SetTTBR1(void* address) {
+  __attribute__((always_inline)) static void SetTTBR1(void* address) {
     asm volatile("msr ttbr1_el1, %0" : : "r"(address));
   }
 
@@ -63,6 +63,16 @@ enum class EPD1 : uint8_t {
   GENERATE_FAULT = 0b1,
 };
 
+enum class A1 : uint8_t {
+  TTBR0_ASID = 0b0,
+  TTBR1_ASID = 0b1,
+};
+
+enum class AS : uint8_t {
+  _8_BIT = 0b0,
+  _16_BIT = 0b1,
+};
+
 enum class TG0 : uint8_t {
   _4KB = 0b00,
   _16KB = 0b10,
@@ -104,14 +114,15 @@ struct TcrRegister
           utils::rtr::Field<SH0, 2>,                             // @12-13
           utils::rtr::Field<TG0, 2>,                             // @14-15
           utils::rtr::Field<uint8_t, 6>,                         // @16-21 T1SZ
-          utils::rtr::Field<bool, 1>,                            // @22 reserved
+          utils::rtr::Field<A1, 1>,                              // @22
           utils::rtr::Field<EPD1, 1>,                            // @23
           utils::rtr::Field<IRGN1, 2>,                           // @24-25
           utils::rtr::Field<ORGN1, 2>,                           // @26-27
           utils::rtr::Field<SH1, 2>,                             // @28-29
           utils::rtr::Field<TG1, 2>,                             // @30-31
           utils::rtr::Field<IPS, 3>,                             // @32-34
-          utils::rtr::Field<uint8_t, 2>,   // @35-36 reserved
+          utils::rtr::Field<bool, 1>,      // @35 reserved
+          utils::rtr::Field<AS, 1>,        // @36
           utils::rtr::Field<uint8_t, 2>,   // @37-38 TBI
           utils::rtr::Field<uint32_t, 25>  // @39-63 reserved
           > {
@@ -122,12 +133,14 @@ struct TcrRegister
   using SH0 = FieldAlias<5>;
   using TG0 = FieldAlias<6>;
   using T1SZ = FieldAlias<7>;
+  using A1 = FieldAlias<8>;
   using EPD1 = FieldAlias<9>;
   using IRGN1 = FieldAlias<10>;
   using ORGN1 = FieldAlias<11>;
   using SH1 = FieldAlias<12>;
   using TG1 = FieldAlias<13>;
   using IPS = FieldAlias<14>;
+  using AS = FieldAlias<16>;
 
   static constexpr uint8_t ConvertToTnSZ(const uint8_t address_length) {
     return (64 - address_length);
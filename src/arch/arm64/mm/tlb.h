@@ -0,0 +1,109 @@
+/*=============================================================================
+Project Z - Operating system for ARM processors
+Copyright (C) 2018 Vladyslav Samodelok <vladfux4@gmail.com>
+All rights reserved.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+=============================================================================*/
+#ifndef ARCH_ARM64_MM_TLB_H_
+#define ARCH_ARM64_MM_TLB_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "kernel/config.h"
+
+namespace arch {
+namespace arm64 {
+namespace mm {
+
+/**
+ * @brief The TLB maintenance of the inner shareable domain
+ *
+ * Descriptor writes are made visible to the table walker before
+ * invalidation, completion is waited before return.
+ */
+class Tlb {
+ public:
+  static constexpr size_t kPageBytes = (1ULL << 12);
+
+  __attribute__((always_inline)) static void InvalidateAll() {
+    asm volatile(
+        "dsb ishst\n"
+        "tlbi vmalle1is\n"
+        "dsb ish\n"
+        "isb" ::: "memory");
+  }
+
+  /**
+   * @brief Make descriptor writes visible to the table walker
+   */
+  __attribute__((always_inline)) static void SyncTables() {
+    asm volatile(
+        "dsb ishst\n"
+        "isb" ::: "memory");
+  }
+
+  /**
+   * @brief Invalidate non-global translations tagged by ASID
+   */
+  __attribute__((always_inline)) static void InvalidateAsid(const uint16_t asid) {
+    const uint64_t operand = (static_cast<uint64_t>(asid) << 48);
+    asm volatile(
+        "dsb ishst\n"
+        "tlbi aside1is, %0\n"
+        "dsb ish\n"
+        "isb" ::"r"(operand) : "memory");
+  }
+
+  /**
+   * @brief Invalidate translations of range
+   *
+   * Leaf only invalidation keeps cached walks of upper levels, it is
+   * allowed only if no table descriptor was changed. Ranges longer than
+   * KERNEL_TLB_RANGE_THRESHOLD pages are replaced by the full flush.
+   */
+  static void InvalidateRange(const void* begin, const size_t length,
+                              const bool leaf, const uint16_t asid = 0) {
+    const size_t pages = ((length + kPageBytes - 1) / kPageBytes);
+    if (pages > kernel::KERNEL_TLB_RANGE_THRESHOLD) {
+      InvalidateAll();
+      return;
+    }
+
+    uint64_t operand = (Operand(begin) | (static_cast<uint64_t>(asid) << 48));
+    asm volatile("dsb ishst" ::: "memory");
+    for (size_t i = 0; i < pages; ++i, ++operand) {
+      if (leaf) {
+        asm volatile("tlbi vale1is, %0" ::"r"(operand) : "memory");
+      } else {
+        asm volatile("tlbi vae1is, %0" ::"r"(operand) : "memory");
+      }
+    }
+
+    asm volatile(
+        "dsb ish\n"
+        "isb" ::: "memory");
+  }
+
+ private:
+  // operand holds VA[55:12] in bits [43:0]
+  static uint64_t Operand(const void* address) {
+    return ((reinterpret_cast<uint64_t>(address) >> 12) & ((1ULL << 44) - 1));
+  }
+};
+
+}  // namespace mm
+}  // namespace arm64
+}  // namespace arch
+
+#endif  // ARCH_ARM64_MM_TLB_H_
@@ -118,6 +118,17 @@ enum class AF {
   IGNORE = 1,
 };
 
+/**
+ * @brief The not global bit enum
+ *
+ * Translations of not global entries are cached with ASID of
+ * the current address space
+ */
+enum class NG {
+  GLOBAL = 0,
+  NOT_GLOBAL = 1,
+};
+
 /**
  * @brief The Contiguous bit enum
  *
@@ -249,9 +260,10 @@ struct __attribute__((__packed__)) EntryDescriptor
           utils::rtr::Field<S2AP, 2>,        // @6-7
           utils::rtr::Field<SH, 2>,          // @8-9
           utils::rtr::Field<AF, 1>,          // @10 Accessable flag
+          utils::rtr::Field<NG, 1>,          // @11 Not global
           utils::rtr::Field<uint64_t,
                             (EntryAddressStartBit<kPageSize, kLvl>::value -
-                             11)>,  // @11-(X-1) Set to 0
+                             12)>,  // @12-(X-1) Set to 0
           utils::rtr::Field<uint64_t,
                             (48 - EntryAddressStartBit<kPageSize, kLvl>::
                                       value)>,  // @X-47 N Bits of address
@@ -269,11 +281,12 @@ struct __attribute__((__packed__)) EntryDescriptor
       typename EntryDescriptor<kPageSize, kLvl>::template FieldAlias<2>;
   using SH = typename EntryDescriptor<kPageSize, kLvl>::template FieldAlias<3>;
   using AF = typename EntryDescriptor<kPageSize, kLvl>::template FieldAlias<4>;
+  using NG = typename EntryDescriptor<kPageSize, kLvl>::template FieldAlias<5>;
   using Address =
-      typename EntryDescriptor<kPageSize, kLvl>::template FieldAlias<6>;
+      typename EntryDescriptor<kPageSize, kLvl>::template FieldAlias<7>;
   using Contiguous =
-      typename EntryDescriptor<kPageSize, kLvl>::template FieldAlias<8>;
-  using XN = typename EntryDescriptor<kPageSize, kLvl>::template FieldAlias<10>;
+      typename EntryDescriptor<kPageSize, kLvl>::template FieldAlias<9>;
+  using XN = typename EntryDescriptor<kPageSize, kLvl>::template FieldAlias<11>;
 
   static_assert(!((kernel::mm::PageSize::_16KB == kPageSize) &&
                   (TableLvl::_1 == kLvl)),
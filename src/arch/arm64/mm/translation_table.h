@@ -63,11 +63,59 @@ enum class LookupLevel : uint8_t {
 
 using LookupLevelInt = std::underlying_type<LookupLevel>::type;
 
+/**
+ * @brief The valid entries of a descriptor table
+ *
+ * Kept out of the table, so the hardware format is unchanged. Valid
+ * entries are found by counting zeros of bitmap words.
+ */
+template <size_t kEntryCount>
+struct TableOccupancy {
+  static constexpr size_t kWordBits = 64;
+  static constexpr size_t kWords = (kEntryCount / kWordBits);
+  static constexpr size_t kNone = static_cast<size_t>(-1);
+
+  void Set(const size_t index, const bool valid) {
+    const uint64_t bit = (1ULL << (index % kWordBits));
+    uint64_t& word = words[index / kWordBits];
+    if (valid != (0 != (word & bit))) {
+      word ^= bit;
+      count = valid ? (count + 1) : (count - 1);
+    }
+  }
+
+  /**
+   * @brief Get first valid entry starting from index
+   */
+  size_t Next(const size_t index) const {
+    size_t word = (index / kWordBits);
+    if (word >= kWords) {
+      return kNone;
+    }
+
+    uint64_t bits = (words[word] & (~0ULL << (index % kWordBits)));
+    while (0 == bits) {
+      if (++word == kWords) {
+        return kNone;
+      }
+      bits = words[word];
+    }
+
+    return ((word * kWordBits) + __builtin_ctzll(bits));
+  }
+
+  bool Empty() const { return (0 == count); }
+
+  uint64_t words[kWords];
+  size_t count;
+};
+
 template <kernel::mm::PageSize kPageSize>
 struct DescriptorTable {
  public:
   using TableItem = TableDescriptor<kPageSize>;
   static constexpr size_t kEntryCount = TableEntryCount<kPageSize>::value;
+  using Occupancy = TableOccupancy<kEntryCount>;
 
   template <TableLvl kLevel>
   using EntryItem = EntryDescriptor<kPageSize, kLevel>;
@@ -79,46 +127,37 @@ struct DescriptorTable {
 
   class Iterator {
    public:
-    Iterator(Item* buffer, size_t index) : buffer_(buffer), index_(index) {}
+    Iterator(Item* buffer, const Occupancy* occupancy, size_t index)
+        : buffer_(buffer), occupancy_(occupancy), index_(index) {}
 
     Item* operator->() const { return &buffer_[index_]; }
     Item& operator*() const { return buffer_[index_]; }
+    size_t Index() const { return index_; }
     bool operator!=(const Iterator& it) const {
       return (it.buffer_ != buffer_) || (it.index_ != index_);
     }
 
     Iterator& operator++(int) {
-      for (auto i = (index_ + 1); i < kEntryCount; i++) {
-        if (Get<typename TableItem::EntryType>(Get<TableItem>(buffer_[i])) !=
-            EntryType::INVALID) {
-          index_ = i;
-          return *this;
-        }
-      }
-
-      index_ = kEndIndex;
+      index_ = occupancy_->Next(index_ + 1);
       return *this;
     }
 
-    static constexpr size_t kEndIndex = static_cast<size_t>(-1);
+    static constexpr size_t kEndIndex = Occupancy::kNone;
 
    private:
     Item* buffer_;
+    const Occupancy* occupancy_;
     size_t index_;
   };
 
-  Iterator Begin() {
-    for (size_t i = 0; i < kEntryCount; i++) {
-      auto type = Get<typename TableItem::EntryType>(Get<TableItem>(data[i]));
-      if (type != EntryType::INVALID) {
-        return Iterator(data, i);
-      }
-    }
-
-    return End();
+  /**
+   * @brief Iterate valid entries which are tracked by occupancy
+   */
+  Iterator Begin(const Occupancy& occupancy) {
+    return Iterator(data, &occupancy, occupancy.Next(0));
   }
 
-  Iterator End() { return Iterator(data, Iterator::kEndIndex); }
+  Iterator End() { return Iterator(data, nullptr, Iterator::kEndIndex); }
 
  private:
   Item data[kEntryCount];
@@ -141,6 +180,10 @@ class TranslationTableConfig<kernel::mm::PageSize::_4KB, kAddressLength> {
   };
 
   static constexpr BlockSize kMinBlockSize = BlockSize::_4KB;
+  // biggest size which can be mapped by a block descriptor
+  static constexpr BlockSize kMaxBlockSize = BlockSize::_1GB;
+  // entries in a run which can be cached as one TLB entry
+  static constexpr size_t kContiguousEntries = 16;
   static constexpr kernel::mm::PageSize kPageSize = kernel::mm::PageSize::_4KB;
   using Table = DescriptorTable<kPageSize>;
 
@@ -185,6 +228,10 @@ class TranslationTableConfig<kernel::mm::PageSize::_4KB, kAddressLength> {
            (12 + (9 * (static_cast<LookupLevelInt>(level) - 1)));
   }
 
+  static constexpr size_t BlockBytes(const BlockSize size) {
+    return (1ULL << (12 + (9 * static_cast<size_t>(size))));
+  }
+
   static inline BlockSize CalcBlockSizeFromTableLevel(const LookupLevel level) {
     switch (level) {
       case LookupLevel::_4:
@@ -210,6 +257,7 @@ class TranslationTable {
   using Page = kernel::mm::Page<kPageSize>;
   using TableAllocator = AllocatorBase<Table, sizeof(Table)>;
   using PageAllocator = AllocatorBase<Page, sizeof(Page)>;
+  using Occupancy = typename Table::Occupancy;
 
   struct EntryParameters {
     BlockSize size;
@@ -219,22 +267,170 @@ class TranslationTable {
     AF af;
     Contiguous contiguous;
     XN xn;
+    NG ng;
+  };
+
+  /**
+   * @brief The virtual range which translations were changed
+   */
+  struct Change {
+    size_t begin = static_cast<size_t>(-1);
+    size_t end = 0;
+    bool tables = false;  // table descriptors were changed
+
+    void Add(const size_t range_begin, const size_t range_end) {
+      begin = (range_begin < begin) ? range_begin : begin;
+      end = (range_end > end) ? range_end : end;
+    }
+
+    bool Empty() const { return (begin >= end); }
+  };
+
+  /**
+   * @brief The output of the leaf entry which maps virtual address
+   */
+  struct Translation {
+    size_t address;  // output address of the virtual address
+    size_t bytes;    // size of the leaf entry, 0 if not mapped
+
+    bool Valid() const { return (0 != bytes); }
   };
 
-  TranslationTable() : root_table_(nullptr) {
+  /**
+   * @brief Invalidates TLB entries of range, called between the break and
+   *        the make of live entries
+   */
+  using Flush = void (*)(void* context, const TranslationTable& table,
+                         const Change& change);
+
+  TranslationTable()
+      : root_table_(nullptr),
+        source_(nullptr),
+        next_sharer_(nullptr),
+        sharers_head_(nullptr),
+        sharers_(0),
+        shared_(),
+        occupancy_(),
+        last_(nullptr),
+        flush_(nullptr),
+        flush_context_(nullptr) {
     LOG(DEBUG) << "Constructor";
     root_table_ = MakeTable();
+    InvalidateWalkCache();
   }
 
   ~TranslationTable() {
     LOG(DEBUG) << "Destructor";
+    assert(0 == sharers_);
     DeallocTable(*root_table_, Config::kTableLevel);
-    TableAllocator::Deallocate(root_table_);
+    FreeTable(root_table_);
+
+    if (nullptr != source_) {
+      TranslationTable** link = &source_->sharers_head_;
+      while (*link != this) {
+        link = &(*link)->next_sharer_;
+      }
+      *link = next_sharer_;
+      source_->sharers_--;
+    }
   }
 
+  /**
+   * @brief Link root entries of source table to this table
+   *
+   * Tables below the linked entries stay owned by the source and are
+   * never changed through this table. Root entries used by this table
+   * are kept. Later root entry writes of the source are copied to this
+   * table at once, so it never links a table freed by the source.
+   */
+  void Share(TranslationTable& source) {
+    if (&source != source_) {
+      assert(nullptr == source_);
+      source_ = &source;
+      next_sharer_ = source_->sharers_head_;
+      source_->sharers_head_ = this;
+      source_->sharers_++;
+    }
+
+    for (size_t index = 0; index < Table::kEntryCount; ++index) {
+      Link(index, Raw(*source.root_table_, index));
+    }
+
+    InvalidateWalkCache();
+  }
+
+  /**
+   * @brief Set TLB invalidation of the break-before-make sequence, table
+   *        which is never walked by the MMU needs none
+   */
+  void SetFlush(Flush flush, void* context) {
+    flush_ = flush;
+    flush_context_ = context;
+  }
+
+  /**
+   * @brief Number of tables which link root entries of this table
+   */
+  size_t Sharers() const { return sharers_; }
+
+  /**
+   * @brief Translate virtual address by the software table walk
+   *
+   * Leaf tables of recently walked 2MB windows are cached, so repeated
+   * lookups in the same window read the page entry directly. Leaf tables
+   * of the shared source are not cached, the source frees them without
+   * notice.
+   */
+  Translation Translate(const void* v_ptr) {
+    const auto v_address = reinterpret_cast<size_t>(v_ptr);
+    constexpr size_t kPageBytes = Config::BlockBytes(Config::kMinBlockSize);
+    const size_t window = (v_address >> kWalkWindowShift);
+    auto& cached = walk_cache_[window & (kWalkCacheSize - 1)];
+
+    if (cached.window == window) {
+      const uint64_t raw =
+          Raw(*cached.table, Config::CalcIndex(v_ptr, LookupLevel::_1));
+      return Output(raw, v_address, kPageBytes);
+    }
+
+    Table* table = root_table_;
+    bool shared = false;
+    for (LookupLevel level = Config::kTableLevel;; level = NextLevel(level)) {
+      const size_t index = Config::CalcIndex(v_ptr, level);
+      const uint64_t raw = Raw(*table, index);
+      const size_t bytes =
+          Config::BlockBytes(Config::CalcBlockSizeFromTableLevel(level));
+      shared = shared || Shared(*table, index);
+
+      if ((LookupLevel::_1 == level) || !IsTable(raw)) {
+        return Output(raw, v_address, bytes);
+      }
+
+      table = &TableAt(*table, index);
+      if ((LookupLevel::_2 == level) && !shared) {
+        cached = {window, table};
+      }
+    }
+  }
+
+  /**
+   * @brief Forget cached leaf tables, called when tables are freed
+   */
+  void InvalidateWalkCache() {
+    for (auto& cached : walk_cache_) {
+      cached = {kNoWindow, nullptr};
+    }
+  }
+
+  /**
+   * @brief Free tables below valid entries, empty entries are skipped
+   */
   void DeallocTable(Table& table, const LookupLevel level) {
-    for (auto it = table.Begin(); it != table.End(); it++) {
+    for (auto it = table.Begin(OccupancyOf(table)); it != table.End(); it++) {
       auto& item = Get<typename Table::TableItem>(*it);
+      if ((&table == root_table_) && IsShared(it.Index())) {
+        continue;
+      }
 
       auto type = Get<typename Table::TableItem::EntryType>(item);
       void* next_item = item.GetAddress();
@@ -248,7 +444,7 @@ class TranslationTable {
           next_level--;
           auto next_level_table = reinterpret_cast<Table*>(next_item);
           DeallocTable(*next_level_table, next_level.Value());
-          TableAllocator::Deallocate(next_level_table);
+          FreeTable(next_level_table);
         } else {
 //          Pages are now deallocated by kernel::memory::Region
 //          PageAllocator::Deallocate(reinterpret_cast<Page*>(next_item));
@@ -265,6 +461,300 @@ class TranslationTable {
                 std::get<Table*>(chain_info));
   }
 
+  /**
+   * @brief Map range by the largest blocks allowed by alignment of both
+   *        virtual and physical addresses
+   *
+   * Tables are walked down once, consecutive entries of each table are
+   * filled in place and the walk goes back up only at table boundaries.
+   * Contiguous hint is set by the mapper on every aligned run of
+   * kContiguousEntries entries, the caller value is ignored.
+   */
+  void MapRange(const void* v_ptr, const void* p_ptr, const size_t length,
+                EntryParameters param) {
+    constexpr size_t kMinBytes = Config::BlockBytes(Config::kMinBlockSize);
+    const auto v_address = reinterpret_cast<size_t>(v_ptr);
+    const size_t end = (v_address + (length & ~(kMinBytes - 1)));
+
+    MapLevel(*root_table_, Config::kTableLevel, v_address,
+             reinterpret_cast<size_t>(p_ptr), end, param);
+  }
+
+  void MapLevel(Table& table, const LookupLevel level, size_t v_address,
+                size_t p_address, const size_t end, EntryParameters& param) {
+    const BlockSize size = Config::CalcBlockSizeFromTableLevel(level);
+    const size_t bytes = Config::BlockBytes(size);
+    const size_t mask = (bytes - 1);
+    const size_t run_mask = ((bytes * Config::kContiguousEntries) - 1);
+    const bool leaf = (Config::kMinBlockSize == size);
+    size_t hinted = 0;
+
+    for (size_t index = Config::CalcIndex(reinterpret_cast<void*>(v_address),
+                                          level);
+         (v_address < end) && (index < Table::kEntryCount); ++index) {
+      const size_t entry_end = ((v_address & ~mask) + bytes);
+      const size_t next = (entry_end < end) ? entry_end : end;
+      const bool block = ((size <= Config::kMaxBlockSize) &&
+                          (0 == ((v_address | p_address) & mask)) &&
+                          ((end - v_address) >= bytes));
+
+      if (Shared(table, index)) {
+        LOG(ERROR) << "Map to shared root entry: " << index;
+      } else if (leaf || block) {
+        if (0 == hinted) {
+          const bool run = (((end - v_address) > run_mask) &&
+                            (0 == ((v_address | p_address) & run_mask)));
+          param.contiguous = run ? Contiguous::ON : Contiguous::OFF;
+          hinted = run ? Config::kContiguousEntries : 0;
+        }
+
+        Replace(table, index, level, (v_address & ~mask));
+        param.size = size;
+        SetEntry(table, index, level, reinterpret_cast<void*>(p_address),
+                 param);
+        hinted = (0 != hinted) ? (hinted - 1) : 0;
+      } else {
+        MapLevel(NextTable(table, index, level, (v_address & ~mask)),
+                 NextLevel(level), v_address, p_address, next, param);
+      }
+
+      p_address += (next - v_address);
+      v_address = next;
+    }
+  }
+
+  /**
+   * @brief Clear translations of range, tables left empty are freed
+   *
+   * Blocks partially covered by the range are split to the next level.
+   */
+  Change UnmapRange(const void* v_ptr, const size_t length) {
+    Change change;
+    const auto v_address = reinterpret_cast<size_t>(v_ptr);
+    UnmapLevel(*root_table_, Config::kTableLevel, v_address,
+               (v_address + length), change);
+    if (change.tables) {
+      InvalidateWalkCache();
+    }
+    return change;
+  }
+
+  /**
+   * @brief Change attributes of mapped translations of range
+   */
+  Change Protect(const void* v_ptr, const size_t length,
+                 const EntryParameters& param) {
+    Change change;
+    const auto v_address = reinterpret_cast<size_t>(v_ptr);
+    ProtectLevel(*root_table_, Config::kTableLevel, v_address,
+                 (v_address + length), param, change);
+    if (change.tables) {
+      InvalidateWalkCache();
+    }
+    return change;
+  }
+
+  void UnmapLevel(Table& table, const LookupLevel level, size_t v_address,
+                  const size_t end, Change& change) {
+    const size_t bytes = Config::BlockBytes(
+        Config::CalcBlockSizeFromTableLevel(level));
+    const bool leaf = (LookupLevel::_1 == level);
+
+    for (size_t index = Config::CalcIndex(reinterpret_cast<void*>(v_address),
+                                          level);
+         (v_address < end) && (index < Table::kEntryCount); ++index) {
+      const size_t entry_begin = (v_address & ~(bytes - 1));
+      const size_t entry_end = (entry_begin + bytes);
+      const size_t next = (entry_end < end) ? entry_end : end;
+      const uint64_t raw = Raw(table, index);
+
+      if ((0 == (raw & kValidBit)) || Shared(table, index)) {
+        // nothing is mapped or entry is owned by the shared source
+      } else if (!leaf && IsTable(raw)) {
+        Table& next_table = TableAt(table, index);
+        UnmapLevel(next_table, NextLevel(level), v_address, next, change);
+        if (OccupancyOf(next_table).Empty()) {
+          // walks of the whole table span can be cached
+          Raw(table, index) = 0;
+          Changed(table, index);
+          FreeTable(&next_table);
+          change.tables = true;
+          change.Add(entry_begin, entry_end);
+        }
+      } else if ((entry_begin == v_address) && (entry_end == next)) {
+        BreakContiguous(table, index, entry_begin, bytes, change);
+        Raw(table, index) = 0;
+        Changed(table, index);
+        change.Add(entry_begin, entry_end);
+      } else {
+        BreakContiguous(table, index, entry_begin, bytes, change);
+        Table& next_table = SplitBlock(table, index, level, entry_begin);
+        change.tables = true;
+        change.Add(entry_begin, entry_end);
+        UnmapLevel(next_table, NextLevel(level), v_address, next, change);
+      }
+
+      v_address = next;
+    }
+  }
+
+  void ProtectLevel(Table& table, const LookupLevel level, size_t v_address,
+                    const size_t end, const EntryParameters& param,
+                    Change& change) {
+    const BlockSize size = Config::CalcBlockSizeFromTableLevel(level);
+    const size_t bytes = Config::BlockBytes(size);
+    const bool leaf = (LookupLevel::_1 == level);
+
+    for (size_t index = Config::CalcIndex(reinterpret_cast<void*>(v_address),
+                                          level);
+         (v_address < end) && (index < Table::kEntryCount); ++index) {
+      const size_t entry_begin = (v_address & ~(bytes - 1));
+      const size_t entry_end = (entry_begin + bytes);
+      const size_t next = (entry_end < end) ? entry_end : end;
+      const uint64_t raw = Raw(table, index);
+
+      if ((0 == (raw & kValidBit)) || Shared(table, index)) {
+        // nothing is mapped or entry is owned by the shared source
+      } else if (!leaf && IsTable(raw)) {
+        ProtectLevel(TableAt(table, index), NextLevel(level), v_address, next,
+                     param, change);
+      } else if ((entry_begin == v_address) && (entry_end == next)) {
+        BreakContiguous(table, index, entry_begin, bytes, change);
+        auto entry_param = param;
+        entry_param.size = size;
+        entry_param.contiguous = Contiguous::OFF;
+        const auto p_ptr = reinterpret_cast<void*>(raw & kOutputAddressMask);
+        const uint64_t value = EntryRaw(level, p_ptr, entry_param);
+        if (0 != ((Raw(table, index) ^ value) & ~kPermissionMask)) {
+          // only permissions may change on a live entry
+          Break(table, index, 1, entry_begin, entry_end);
+        }
+
+        Raw(table, index) = value;
+        Changed(table, index);
+        change.Add(entry_begin, entry_end);
+      } else {
+        BreakContiguous(table, index, entry_begin, bytes, change);
+        Table& next_table = SplitBlock(table, index, level, entry_begin);
+        change.tables = true;
+        change.Add(entry_begin, entry_end);
+        ProtectLevel(next_table, NextLevel(level), v_address, next, param,
+                     change);
+      }
+
+      v_address = next;
+    }
+  }
+
+  /**
+   * @brief Replace block by table of next level entries with the same
+   *        output addresses and attributes
+   *
+   * New table is filled before the block is broken, so the range is
+   * unmapped only between the break and the link.
+   */
+  Table& SplitBlock(Table& table, const size_t index, const LookupLevel level,
+                    const size_t entry_begin) {
+    const LookupLevel next_level = NextLevel(level);
+    const BlockSize next_size = Config::CalcBlockSizeFromTableLevel(next_level);
+    const size_t next_bytes = Config::BlockBytes(next_size);
+    const uint64_t raw = Raw(table, index);
+    const uint64_t type =
+        (Config::kMinBlockSize == next_size)
+            ? static_cast<uint64_t>(EntryType::TABLE)
+            : static_cast<uint64_t>(EntryType::BLOCK);
+    const uint64_t attributes =
+        (raw & ~(kOutputAddressMask | kContiguousBit | kTypeMask));
+    const uint64_t address = (raw & kOutputAddressMask);
+
+    Table* next_table = MakeTable();
+    for (size_t i = 0; i < Table::kEntryCount; ++i) {
+      Raw(*next_table, i) = (attributes | (address + (i * next_bytes)) | type);
+      Changed(*next_table, i);
+    }
+
+    const size_t bytes =
+        Config::BlockBytes(Config::CalcBlockSizeFromTableLevel(level));
+    Break(table, index, 1, entry_begin, (entry_begin + bytes));
+    LinkTable(table, index, next_table);
+    return *next_table;
+  }
+
+  /**
+   * @brief Break live entry before it is overwritten by a new leaf, table
+   *        below the entry is freed with its occupancy
+   */
+  void Replace(Table& table, const size_t index, const LookupLevel level,
+               const size_t entry_begin) {
+    const uint64_t raw = Raw(table, index);
+    if (0 == (raw & kValidBit)) {
+      return;
+    }
+
+    const size_t bytes =
+        Config::BlockBytes(Config::CalcBlockSizeFromTableLevel(level));
+    if ((LookupLevel::_1 != level) && IsTable(raw)) {
+      Table& next_table = TableAt(table, index);
+      Break(table, index, 1, entry_begin, (entry_begin + bytes));
+      DeallocTable(next_table, NextLevel(level));
+      FreeTable(&next_table);
+      InvalidateWalkCache();
+      return;
+    }
+
+    Change change;
+    BreakContiguous(table, index, entry_begin, bytes, change);
+    Break(table, index, 1, entry_begin, (entry_begin + bytes));
+  }
+
+  /**
+   * @brief Invalidate live entries and their TLB entries, so new entries
+   *        can be written without conflicting with cached ones
+   */
+  void Break(Table& table, const size_t first, const size_t count,
+             const size_t begin, const size_t end) {
+    for (size_t i = first; i < (first + count); ++i) {
+      Raw(table, i) = 0;
+      Changed(table, i);
+    }
+
+    if (nullptr != flush_) {
+      Change change;
+      change.Add(begin, end);
+      change.tables = true;
+      flush_(flush_context_, *this, change);
+    }
+  }
+
+  /**
+   * @brief Entries of a contiguous run must stay consistent, so the hint of
+   *        the whole run is cleared before one of them is changed
+   */
+  void BreakContiguous(Table& table, const size_t index,
+                       const size_t entry_begin, const size_t bytes,
+                       Change& change) {
+    if (0 == (Raw(table, index) & kContiguousBit)) {
+      return;
+    }
+
+    const size_t first = (index & ~(Config::kContiguousEntries - 1));
+    const size_t run_bytes = (bytes * Config::kContiguousEntries);
+    const size_t run_begin = (entry_begin & ~(run_bytes - 1));
+    uint64_t run[Config::kContiguousEntries];
+    for (size_t i = 0; i < Config::kContiguousEntries; ++i) {
+      run[i] = (Raw(table, first + i) & ~kContiguousBit);
+    }
+
+    Break(table, first, Config::kContiguousEntries, run_begin,
+          (run_begin + run_bytes));
+    for (size_t i = 0; i < Config::kContiguousEntries; ++i) {
+      Raw(table, first + i) = run[i];
+      Changed(table, first + i);
+    }
+
+    change.Add(run_begin, (run_begin + run_bytes));
+  }
+
   std::pair<Table*, LookupLevel> CreateTableChain(const void* v_ptr,
                                                   const BlockSize size) {
     using LevelIterator = utils::EnumIterator<LookupLevel, 0>;
@@ -273,47 +763,95 @@ class TranslationTable {
     for (; (LevelIterator::End() != it) &&
            (Config::CalcBlockSizeFromTableLevel(it.Value()) != size);
          it--) {
-      size_t index = Config::CalcIndex(v_ptr, it.Value());
-      Table* next_level_table = reinterpret_cast<Table*>(
-          table->at(index)
-              .template Get<typename Table::TableItem>()
-              .GetAddress());
-
-      if (nullptr == next_level_table) {
-        next_level_table = MakeTable();
-        auto new_item = typename Table::TableItem();
-        new_item.Set(typename Table::TableItem::EntryType(EntryType::TABLE),
-                     typename Table::TableItem::Address(
-                         Table::TableItem::ToTableAddress(next_level_table)),
-                     typename Table::TableItem::PXN(PXN::EXECUTE),
-                     typename Table::TableItem::XN(XN::EXECUTE),
-                     typename Table::TableItem::AP(AP::NOEFFECT),
-                     typename Table::TableItem::NsTable(NSTable::NON_SECURE));
-        table->at(index) = new_item;
-      }
-
-      table = next_level_table;
+      const size_t bytes =
+          Config::BlockBytes(Config::CalcBlockSizeFromTableLevel(it.Value()));
+      table = &NextTable(*table, Config::CalcIndex(v_ptr, it.Value()),
+                         it.Value(),
+                         (reinterpret_cast<size_t>(v_ptr) & ~(bytes - 1)));
     }
 
     return {table, it.Value()};
   }
 
+  /**
+   * @brief Get table referenced by the entry, block is split, so the rest
+   *        of its translations is kept, empty entry gets a new table
+   */
+  Table& NextTable(Table& table, const size_t index, const LookupLevel level,
+                   const size_t entry_begin) {
+    const uint64_t raw = Raw(table, index);
+    if (IsTable(raw)) {
+      return TableAt(table, index);
+    }
+
+    if (0 != (raw & kValidBit)) {
+      const size_t bytes =
+          Config::BlockBytes(Config::CalcBlockSizeFromTableLevel(level));
+      Change change;
+      BreakContiguous(table, index, entry_begin, bytes, change);
+      return SplitBlock(table, index, level, entry_begin);
+    }
+
+    Table* next_level_table = MakeTable();
+    LinkTable(table, index, next_level_table);
+    return *next_level_table;
+  }
+
+  void LinkTable(Table& table, const size_t index, Table* next_level_table) {
+    auto new_item = typename Table::TableItem();
+    new_item.Set(typename Table::TableItem::EntryType(EntryType::TABLE),
+                 typename Table::TableItem::Address(
+                     Table::TableItem::ToTableAddress(next_level_table)),
+                 typename Table::TableItem::PXN(PXN::EXECUTE),
+                 typename Table::TableItem::XN(XN::EXECUTE),
+                 typename Table::TableItem::AP(AP::NOEFFECT),
+                 typename Table::TableItem::NsTable(NSTable::NON_SECURE));
+    table.at(index) = new_item;
+    Changed(table, index);
+  }
+
+  static uint64_t& Raw(Table& table, const size_t index) {
+    return table.at(index).template Get<typename Table::TableItem>().value;
+  }
+
+  static bool IsTable(const uint64_t raw) {
+    return (static_cast<uint64_t>(EntryType::TABLE) == (raw & kTypeMask));
+  }
+
+  static Table& TableAt(Table& table, const size_t index) {
+    return *reinterpret_cast<Table*>(
+        table.at(index).template Get<typename Table::TableItem>().GetAddress());
+  }
+
+  static LookupLevel NextLevel(const LookupLevel level) {
+    return static_cast<LookupLevel>(static_cast<LookupLevelInt>(level) - 1);
+  }
+
   void CreateEntry(const void* v_ptr, const void* p_ptr,
                    const EntryParameters& param, const LookupLevel level,
                    Table* table) {
+    SetEntry(*table, Config::CalcIndex(v_ptr, level), level, p_ptr, param);
+  }
+
+  void SetEntry(Table& table, const size_t index, const LookupLevel level,
+                const void* p_ptr, const EntryParameters& param) {
+    Raw(table, index) = EntryRaw(level, p_ptr, param);
+    Changed(table, index);
+  }
+
+  uint64_t EntryRaw(const LookupLevel level, const void* p_ptr,
+                    const EntryParameters& param) {
     uint64_t address = Config::CalcEntryAddress(p_ptr, level);
     auto entry_type = (Config::kMinBlockSize == param.size) ? EntryType::TABLE
                                                             : EntryType::BLOCK;
-    const auto index = Config::CalcIndex(v_ptr, level);
-    auto& entry = table->at(index);
 
     if (LookupLevel::_3 == level) {
-      entry = MakeEntry<TableLvl::_1>(entry_type, address, param);
+      return MakeEntry<TableLvl::_1>(entry_type, address, param).value;
     } else if (LookupLevel::_2 == level) {
-      entry = MakeEntry<TableLvl::_2>(entry_type, address, param);
-    } else if (LookupLevel::_1 == level) {
-      entry = MakeEntry<TableLvl::_3>(entry_type, address, param);
+      return MakeEntry<TableLvl::_2>(entry_type, address, param).value;
     }
+
+    return MakeEntry<TableLvl::_3>(entry_type, address, param).value;
   }
 
   template <TableLvl kLvl>
@@ -328,7 +866,7 @@ class TranslationTable {
               typename Entry::S2AP(param.s2ap), typename Entry::SH(param.sh),
               typename Entry::AF(param.af),
               typename Entry::Contiguous(param.contiguous),
-              typename Entry::XN(param.xn));
+              typename Entry::XN(param.xn), typename Entry::NG(param.ng));
 
     return entry;
   }
@@ -336,11 +874,152 @@ class TranslationTable {
   Table* MakeTable() {
     Table* table = TableAllocator::Make();
     LOG(VERBOSE) << "New table by address: " << table;
+
+    auto node = OccupancyAllocator::Make();
+    auto& bucket = occupancy_[Bucket(table)];
+    node->table = table;
+    node->next = bucket;
+    bucket = node;
     return table;
   }
 
+  void FreeTable(Table* table) {
+    OccupancyNode** link = &occupancy_[Bucket(table)];
+    while ((*link)->table != table) {
+      link = &(*link)->next;
+    }
+
+    OccupancyNode* node = *link;
+    *link = node->next;
+    last_ = (last_ == node) ? nullptr : last_;
+    OccupancyAllocator::Deallocate(node);
+    TableAllocator::Deallocate(table);
+  }
+
+  /**
+   * @brief Valid entries of table allocated by this translation table
+   */
+  const Occupancy& OccupancyOf(const Table& table) {
+    return Find(table)->occupancy;
+  }
+
  private:
+  static constexpr uint64_t kValidBit = 0b01;
+  static constexpr uint64_t kTypeMask = 0b11;
+  static constexpr uint64_t kContiguousBit = (1ULL << 52);
+  static constexpr uint64_t kOutputAddressMask = 0x0000FFFFFFFFF000ULL;
+  // AP, AF, PXN and XN, changed without break-before-make
+  static constexpr uint64_t kPermissionMask =
+      ((0b11ULL << 6) | (1ULL << 10) | (1ULL << 53) | (1ULL << 54));
+  static constexpr size_t kSharedWords = (Table::kEntryCount / 64);
+  static constexpr size_t kWalkCacheSize = 8;
+  static constexpr size_t kWalkWindowShift = 21;
+  static constexpr size_t kNoWindow = static_cast<size_t>(-1);
+
+  static constexpr size_t kOccupancyBuckets = 64;
+
+  struct WalkCacheEntry {
+    size_t window;
+    Table* table;
+  };
+
+  struct OccupancyNode {
+    const Table* table = nullptr;
+    OccupancyNode* next = nullptr;
+    Occupancy occupancy = {};
+  };
+
+  using OccupancyAllocator =
+      AllocatorBase<OccupancyNode, alignof(OccupancyNode)>;
+
+  static size_t Bucket(const Table* table) {
+    return ((reinterpret_cast<size_t>(table) / sizeof(Table)) &
+            (kOccupancyBuckets - 1));
+  }
+
+  OccupancyNode* Find(const Table& table) {
+    if ((nullptr != last_) && (last_->table == &table)) {
+      return last_;
+    }
+
+    OccupancyNode* node = occupancy_[Bucket(&table)];
+    while (node->table != &table) {
+      node = node->next;
+    }
+
+    last_ = node;
+    return node;
+  }
+
+  static Translation Output(const uint64_t raw, const size_t v_address,
+                            const size_t bytes) {
+    if (0 == (raw & kValidBit)) {
+      return {0, 0};
+    }
+
+    return {((raw & kOutputAddressMask & ~(bytes - 1)) |
+             (v_address & (bytes - 1))),
+            bytes};
+  }
+
+  /**
+   * @brief Track entry after its descriptor was written
+   *
+   * Root entries are copied to the sharers before the break-before-make
+   * sequence frees the table below, kernel entries are global, so the
+   * flush of the source covers the sharers too.
+   */
+  void Changed(Table& table, const size_t index) {
+    const uint64_t raw = Raw(table, index);
+    Find(table)->occupancy.Set(index, (0 != (raw & kValidBit)));
+    if (&table == root_table_) {
+      for (auto sharer = sharers_head_; nullptr != sharer;
+           sharer = sharer->next_sharer_) {
+        sharer->Link(index, raw);
+      }
+    }
+  }
+
+  /**
+   * @brief Copy root entry of the source, unless this table uses it
+   */
+  void Link(const size_t index, const uint64_t raw) {
+    if (IsShared(index) || (0 == (Raw(*root_table_, index) & kValidBit))) {
+      Raw(*root_table_, index) = raw;
+      SetShared(index, (0 != (raw & kValidBit)));
+      Changed(*root_table_, index);
+    } else if (0 != (raw & kValidBit)) {
+      LOG(ERROR) << "Shared root entry is used by table: " << index;
+    }
+  }
+
+  bool Shared(const Table& table, const size_t index) const {
+    return (&table == root_table_) && IsShared(index);
+  }
+
+  bool IsShared(const size_t index) const {
+    return (0 != (shared_[index / 64] & (1ULL << (index % 64))));
+  }
+
+  void SetShared(const size_t index, const bool shared) {
+    if (shared) {
+      shared_[index / 64] |= (1ULL << (index % 64));
+    } else {
+      shared_[index / 64] &= ~(1ULL << (index % 64));
+    }
+  }
+
   Table* root_table_;
+  TranslationTable* source_;
+  TranslationTable* next_sharer_;   // next table sharing the source
+  TranslationTable* sharers_head_;  // tables which share this table
+  size_t sharers_;
+  uint64_t shared_[kSharedWords];
+  WalkCacheEntry walk_cache_[kWalkCacheSize];
+  OccupancyNode* occupancy_[kOccupancyBuckets];
+  OccupancyNode* last_;  // node of the last changed table
+  Flush flush_;
+  void* flush_context_;
 };
 
 }  // namespace mm
@@ -17,27 +17,205 @@ GNU General Public License for more details.
 #ifndef ARCH_ARM64_MUTEX_H_
 #define ARCH_ARM64_MUTEX_H_
 
+#include <cstddef>
+#include <cstdint>
+
+#include "arch/arm64/cpu.h"
+#include "kernel/config.h"
 #include "kernel/hal/mutex_base.h"
 
 namespace arch {
 namespace arm64 {
 
 /**
- * @brief The Mutex class
+ * @brief IRQ masking shared by all locks, used by IRQ-save guards
+ */
+struct LockIrq {
+  static uint64_t SaveIrq() { return Cpu::SaveIrq(); }
+  static void RestoreIrq(const uint64_t flags) { Cpu::RestoreIrq(flags); }
+};
+
+/**
+ * @brief The Test-and-set spinlock
+ *
+ * Waiters sleep in WFE. Load-acquire exclusive arms the exclusive monitor,
+ * so the release store of the owner clears it and wakes them, no SEV is
+ * needed. Exclusives require the MMU, locks are used only after the boot
+ * code enabled it.
+ */
+class SpinLock : public LockIrq {
+ public:
+  SpinLock() : value_(0) {}
+
+  void Lock() {
+    uint32_t busy;
+    uint32_t failed;
+    asm volatile(
+        "   sevl\n"
+        "1: wfe\n"
+        "2: ldaxr   %w0, [%2]\n"
+        "   cbnz    %w0, 1b\n"
+        "   stxr    %w1, %w3, [%2]\n"
+        "   cbnz    %w1, 2b\n"
+        : "=&r"(busy), "=&r"(failed)
+        : "r"(&value_), "r"(1)
+        : "memory");
+  }
+
+  bool TryLock() {
+    uint32_t busy;
+    uint32_t failed;
+    asm volatile(
+        "1: ldaxr   %w0, [%2]\n"
+        "   cbnz    %w0, 2f\n"
+        "   stxr    %w1, %w3, [%2]\n"
+        "   cbnz    %w1, 1b\n"
+        "2:\n"
+        : "=&r"(busy), "=&r"(failed)
+        : "r"(&value_), "r"(1)
+        : "memory");
+    return (0 == busy);
+  }
+
+  void Unlock() { asm volatile("stlr wzr, [%0]" ::"r"(&value_) : "memory"); }
+
+ private:
+  uint32_t value_;
+};
+
+/**
+ * @brief The Ticket spinlock, cores get the lock in arrival order
+ *
+ * Low half of the word is the owner ticket, high half is the next one.
+ */
+class TicketLock : public LockIrq {
+ public:
+  TicketLock() : value_(0) {}
+
+  void Lock() {
+    uint32_t ticket;
+    uint32_t next;
+    uint32_t tmp;
+    asm volatile(
+        "   prfm    pstl1strm, [%3]\n"
+        "1: ldaxr   %w0, [%3]\n"
+        "   add     %w1, %w0, #(1 << 16)\n"
+        "   stxr    %w2, %w1, [%3]\n"
+        "   cbnz    %w2, 1b\n"
+        // taken ticket is the owner one, lock is free
+        "   eor     %w1, %w0, %w0, ror #16\n"
+        "   cbz     %w1, 3f\n"
+        "   sevl\n"
+        "2: wfe\n"
+        "   ldaxrh  %w2, [%3]\n"
+        "   eor     %w1, %w2, %w0, lsr #16\n"
+        "   cbnz    %w1, 2b\n"
+        "3:\n"
+        : "=&r"(ticket), "=&r"(next), "=&r"(tmp)
+        : "r"(&value_)
+        : "memory");
+  }
+
+  void Unlock() {
+    uint32_t owner;
+    asm volatile(
+        "ldrh    %w0, [%1]\n"
+        "add     %w0, %w0, #1\n"
+        "stlrh   %w0, [%1]\n"
+        : "=&r"(owner)
+        : "r"(&value_)
+        : "memory");
+  }
+
+ private:
+  uint32_t value_;
+};
+
+/**
+ * @brief The MCS queue spinlock
+ *
+ * Each waiter spins on its own queue node, so the release touches only
+ * the cache line of the next owner. Every lock has its own node per core,
+ * so a core may hold several MCS locks, but must not take the same lock
+ * again, e.g. from an interrupt handler.
  */
-class Mutex {
+class McsLock : public LockIrq {
  public:
-  /**
-   * @brief Lock
-   */
-  void Lock();
-
-  /**
-   * @brief Unlock
-   */
-  void Unlock();
+  McsLock() : nodes_(), tail_(nullptr) {}
+
+  void Lock() {
+    Node& node = nodes_[Cpu::CoreId()];
+    node.next = nullptr;
+    node.locked = 1;
+
+    Node* prev = Swap(&tail_, &node);
+    if (nullptr != prev) {
+      __atomic_store_n(&prev->next, &node, __ATOMIC_RELEASE);
+      WaitWhile(&node.locked, 1);
+    }
+  }
+
+  void Unlock() {
+    Node& node = nodes_[Cpu::CoreId()];
+    Node* next = __atomic_load_n(&node.next, __ATOMIC_ACQUIRE);
+    if (nullptr == next) {
+      Node* expected = &node;
+      if (__atomic_compare_exchange_n(&tail_, &expected, nullptr, false,
+                                      __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+        return;
+      }
+
+      // successor swapped the tail, but did not link itself yet
+      do {
+        next = __atomic_load_n(&node.next, __ATOMIC_ACQUIRE);
+      } while (nullptr == next);
+    }
+
+    __atomic_store_n(&next->locked, 0, __ATOMIC_RELEASE);
+  }
+
+ private:
+  struct alignas(64) Node {
+    Node* next;
+    uint32_t locked;
+  };
+
+  static Node* Swap(Node** address, Node* value) {
+    Node* old;
+    uint32_t failed;
+    asm volatile(
+        "1: ldaxr   %0, [%2]\n"
+        "   stlxr   %w1, %3, [%2]\n"
+        "   cbnz    %w1, 1b\n"
+        : "=&r"(old), "=&r"(failed)
+        : "r"(address), "r"(value)
+        : "memory");
+    return old;
+  }
+
+  // sleep in WFE until the store of the previous owner clears the monitor
+  static void WaitWhile(uint32_t* address, const uint32_t value) {
+    uint32_t current;
+    asm volatile(
+        "   sevl\n"
+        "1: wfe\n"
+        "   ldaxr   %w0, [%1]\n"
+        "   cmp     %w0, %w2\n"
+        "   b.eq    1b\n"
+        : "=&r"(current)
+        : "r"(address), "r"(value)
+        : "memory", "cc");
+  }
+
+  Node nodes_[kernel::KERNEL_CPU_COUNT];
+  Node* tail_;
 };
 
+/**
+ * @brief The Mutex of hal::Mutex
+ */
+using Mutex = SpinLock;
+
 }  // namespace arm64
 }  // namespace arch
 
@@ -0,0 +1,73 @@
+/*=============================================================================
+Project Z - Operating system for ARM processors
+Copyright (C) 2018 Vladyslav Samodelok <vladfux4@gmail.com>
+All rights reserved.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+=============================================================================*/
+#include "arch/arm64/smp.h"
+
+#include "arch/arm64/cpu.h"
+#include "kernel/logger.h"
+
+extern "C" {
+
+extern uint8_t _secondary_start;
+
+// read by _secondary_start before MMU is enabled
+arch::arm64::Smp::Boot secondary_boot = {nullptr, nullptr};
+}
+
+namespace arch {
+namespace arm64 {
+
+bool Smp::Start(const EnableMethod method, const uint64_t id,
+                const uint64_t release, void* stack, void* local) {
+  // released core reads memory with caches off
+  secondary_boot = {stack, local};
+  Cpu::CleanToPoc(&secondary_boot, sizeof(secondary_boot));
+
+  const auto entry = reinterpret_cast<uint64_t>(&_secondary_start);
+  register uint64_t x0 asm("x0") = kPsciCpuOn;
+  register uint64_t x1 asm("x1") = id;
+  register uint64_t x2 asm("x2") = entry;
+  register uint64_t x3 asm("x3") = 0;
+
+  switch (method) {
+    case EnableMethod::SPIN_TABLE: {
+      auto slot = reinterpret_cast<volatile uint64_t*>(release);
+      *slot = entry;
+      Cpu::CleanToPoc(slot, sizeof(*slot));
+      asm volatile("sev");
+      return true;
+    }
+    case EnableMethod::PSCI_HVC:
+      asm volatile("hvc #0" : "+r"(x0) : "r"(x1), "r"(x2), "r"(x3) : "memory");
+      break;
+    case EnableMethod::PSCI_SMC:
+      asm volatile("smc #0" : "+r"(x0) : "r"(x1), "r"(x2), "r"(x3) : "memory");
+      break;
+    case EnableMethod::NONE:
+    default:
+      return false;
+  }
+
+  const uint64_t error = x0;
+  if (0 != error) {
+    LOG(ERROR) << "PSCI CPU_ON failed, core: " << id << " error: " << error;
+  }
+
+  return (0 == error);
+}
+
+}  // namespace arm64
+}  // namespace arch
@@ -0,0 +1,69 @@
+/*=============================================================================
+Project Z - Operating system for ARM processors
+Copyright (C) 2018 Vladyslav Samodelok <vladfux4@gmail.com>
+All rights reserved.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+=============================================================================*/
+#ifndef ARCH_ARM64_SMP_H_
+#define ARCH_ARM64_SMP_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace arch {
+namespace arm64 {
+
+/**
+ * @brief The way a secondary core is released by the firmware
+ */
+enum class EnableMethod : uint8_t {
+  NONE,
+  SPIN_TABLE,  // core polls release address
+  PSCI_HVC,    // CPU_ON call to the hypervisor
+  PSCI_SMC,    // CPU_ON call to the secure monitor
+};
+
+/**
+ * @brief The Secondary core release
+ *
+ * Released core enters boot code at EL2 or EL1 with MMU off, switches to
+ * EL1, enables MMU by the boot map and calls SecondaryEntry(local) on the
+ * given stack.
+ */
+class Smp {
+ public:
+  /**
+   * @brief Boot record read by the released core with caches off
+   */
+  struct Boot {
+    void* stack;  // top of the kernel stack
+    void* local;  // argument of SecondaryEntry
+  };
+
+  /**
+   * @brief Release core, one core at a time, the boot record is reused
+   *        once the core is running
+   *
+   * @return false if the core could not be released
+   */
+  static bool Start(const EnableMethod method, const uint64_t id,
+                    const uint64_t release, void* stack, void* local);
+
+ private:
+  static constexpr uint64_t kPsciCpuOn = 0xC4000003;
+};
+
+}  // namespace arm64
+}  // namespace arch
+
+#endif  // ARCH_ARM64_SMP_H_
@@ -193,6 +193,35 @@ struct SavedProcessStatusRegister
   using N = FieldAlias<14>;
 };
 
+enum class ExceptionClass : uint8_t {
+  SVC = 0x15,
+  INSTRUCTION_ABORT_LOWER = 0x20,
+  INSTRUCTION_ABORT = 0x21,
+  DATA_ABORT_LOWER = 0x24,
+  DATA_ABORT = 0x25,
+};
+
+struct SyndromeRegister
+    : public utils::rtr::Register<
+          SyndromeRegister, uint64_t,
+          utils::rtr::Field<uint8_t, 6>,   // @0-5 FSC - Fault status code of
+                                           // an abort.
+          utils::rtr::Field<bool, 1>,      // @6 WnR - Abort was caused by
+                                           // a write.
+          utils::rtr::Field<uint32_t, 18>,  // @7-24 rest of ISS
+          utils::rtr::Field<bool, 1>,      // @25 IL - Instruction length.
+          utils::rtr::Field<ExceptionClass, 6>,  // @26-31 EC - Exception
+                                                 // class.
+          utils::rtr::Field<uint32_t, 32>  // @32-63 reserved
+          > {
+  using FSC = FieldAlias<0>;
+  using WNR = FieldAlias<1>;
+  using IL = FieldAlias<3>;
+  using EC = FieldAlias<4>;
+
+  void ReadEl1() { asm volatile("mrs %0, esr_el1" : "=r"(value)); }
+};
+
 }  // namespace sys
 }  // namespace arm64
 }  // namespace arch
@@ -27,17 +27,18 @@ extern void disable_irq(void);
 namespace arch {
 namespace arm64 {
 
-Timer::Timer(Handler& handler) : cnt_frq_(0), handler_(handler) {
+Timer::Timer(Handler& handler)
+    : cnt_frq_(0), core_(Cpu::CoreId()), handler_(handler) {
   cnt_frq_ = ReadCntFrq();
   WriteCntvTval(cnt_frq_);  // clear cntv interrupt and set next 1 sec timer.
-  RoutingCore0CntvToCore0Irq();
+  RoutingCoreCntvToCoreIrq();
 
   LOG(VERBOSE) << "CNTFRQ  : " << cnt_frq_;
   LOG(VERBOSE) << "CNTV_TVAL  : " << ReadCntvTval();
 }
 
 void Timer::Tick() {
-  if (ReadCore0TimerPending() & 0x08) {
+  if (ReadCoreTimerPending() & 0x08) {
     WriteCntvTval(cnt_frq_);  // clear cntv interrupt and set next 1sec timer.
     
     LOG(VERBOSE) << "handler CNTV_TVAL: " << ReadCntvTval();
@@ -19,6 +19,7 @@ GNU General Public License for more details.
 
 #include <cstdint>
 
+#include "arch/arm64/cpu.h"
 #include "kernel/utils/register.h"
 
 namespace arch {
@@ -61,9 +62,14 @@ class Timer {
     asm volatile("msr cntv_tval_el0, %0" ::"r"(val));
   }
 
-  uint32_t ReadCore0TimerPending() { return MmIoRead(CORE0_IRQ_SOURCE); }
+  // each core has its own local timer registers, 4 bytes apart
+  uint32_t ReadCoreTimerPending() {
+    return MmIoRead(CORE0_IRQ_SOURCE + (4 * core_));
+  }
 
-  void RoutingCore0CntvToCore0Irq() { MmIoWrite(CORE0_TIMER_IRQCNTL, 0x08); }
+  void RoutingCoreCntvToCoreIrq() {
+    MmIoWrite(CORE0_TIMER_IRQCNTL + (4 * core_), 0x08);
+  }
 
   uint64_t ReadCntvCt(void) {
     uint64_t val;
@@ -80,6 +86,7 @@ class Timer {
   static constexpr auto CORE0_TIMER_IRQCNTL = 0x40000040;
 
   uint32_t cnt_frq_;
+  size_t core_;
   Handler& handler_;
 };
 
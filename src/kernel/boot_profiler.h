@@ -0,0 +1,69 @@
+/*=============================================================================
+Project Z - Operating system for ARM processors
+Copyright (C) 2018 Vladyslav Samodelok <vladfux4@gmail.com>
+All rights reserved.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+=============================================================================*/
+#ifndef KERNEL_BOOT_PROFILER_H_
+#define KERNEL_BOOT_PROFILER_H_
+
+#include <cstdint>
+
+#include "arch/arm64/cpu.h"
+#include "kernel/logger.h"
+
+namespace kernel {
+
+/**
+ * @brief The Boot profiler class
+ *
+ * Logs system counter ticks spent in each boot phase.
+ */
+class BootProfiler {
+ public:
+  static void Start() { Start(arch::arm64::Cpu::Counter()); }
+
+  /**
+   * @brief Start from ticks read by the boot code
+   */
+  static void Start(const uint64_t begin) {
+    begin_ = begin;
+    last_ = begin_;
+  }
+
+  static void Mark(const char* phase) {
+    Mark(phase, arch::arm64::Cpu::Counter());
+  }
+
+  /**
+   * @brief Mark phase which ended before logging was available
+   */
+  static void Mark(const char* phase, const uint64_t now) {
+    LOG(INFO) << "Boot phase: " << phase << " ticks: " << (now - last_)
+              << " total: " << (now - begin_);
+    last_ = now;
+  }
+
+  static void LogFrequency() {
+    LOG(INFO) << "Boot counter frequency: "
+              << arch::arm64::Cpu::CounterFrequency();
+  }
+
+ private:
+  static inline uint64_t begin_ = 0;
+  static inline uint64_t last_ = 0;
+};
+
+}  // namespace kernel
+
+#endif  // KERNEL_BOOT_PROFILER_H_
@@ -22,10 +22,33 @@ GNU General Public License for more details.
 #include "kernel/types.h"
 
 namespace kernel {
+
+constexpr size_t KERNEL_CPU_COUNT = 4;
+// kernel stack of each secondary core, core 0 runs on the boot stack
+constexpr size_t KERNEL_STACK_SIZE = (16ULL << 10);
+// pages invalidated one by one, longer ranges flush the whole TLB
+constexpr size_t KERNEL_TLB_RANGE_THRESHOLD = 64;
+// measure lock contention of all online cores on boot
+constexpr bool KERNEL_LOCK_BENCHMARK = false;
+// 16 bits ASID is supported by Cortex-A53, 8 bits is the architectural minimum
+constexpr size_t KERNEL_ASID_BITS = 16;
+// run queue levels, 0 is the highest priority, at most 64
+constexpr size_t KERNEL_PRIORITY_LEVELS = 64;
+// levels below this one are real-time, they preempt normal ones on wake
+constexpr size_t KERNEL_RT_PRIORITY_LEVELS = 16;
+constexpr size_t KERNEL_DEFAULT_PRIORITY = 40;
+// ticks of real-time level, 0 runs the task until it blocks or yields
+constexpr size_t KERNEL_RT_TIME_SLICE = 0;
+// ticks of the highest and the lowest normal level, linear in between
+constexpr size_t KERNEL_TIME_SLICE_MAX = 20;
+constexpr size_t KERNEL_TIME_SLICE_MIN = 2;
+
 namespace mm {
 
 constexpr PageSize KERNEL_PAGE_SIZE = PageSize::_4KB;
 constexpr uint8_t KERNEL_ADDRESS_LENGTH = 39;
+constexpr size_t KERNEL_DMA_ZONE_LIMIT = (64ULL << 20);
+constexpr PageAllocatorType KERNEL_PAGE_ALLOCATOR = PageAllocatorType::BUDDY;
 
 }  // namespace mm
 }  // namespace kernel
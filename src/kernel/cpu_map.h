@@ -0,0 +1,108 @@
+/*=============================================================================
+Project Z - Operating system for ARM processors
+Copyright (C) 2018 Vladyslav Samodelok <vladfux4@gmail.com>
+All rights reserved.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+=============================================================================*/
+#ifndef KERNEL_CPU_MAP_H_
+#define KERNEL_CPU_MAP_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "arch/arm64/mm/boot_map.h"
+#include "arch/arm64/smp.h"
+#include "kernel/config.h"
+#include "kernel/utils/fdt.h"
+
+namespace kernel {
+
+struct CpuBoot {
+  uint64_t id;  // MPIDR affinity
+  arch::arm64::EnableMethod method;
+  uint64_t release;  // spin-table release address
+};
+
+/**
+ * @brief The cores and the way they are released, filled once on boot
+ */
+class CpuMap {
+ public:
+  CpuMap() : cpus_(), count_(0) {}
+
+  bool Add(const CpuBoot& cpu) {
+    if (count_ >= KERNEL_CPU_COUNT) {
+      return false;
+    }
+
+    cpus_[count_++] = cpu;
+    return true;
+  }
+
+  size_t Count() const { return count_; }
+  const CpuBoot* begin() const { return &cpus_[0]; }
+  const CpuBoot* end() const { return &cpus_[count_]; }
+
+  /**
+   * @brief Raspberry Pi 3 cores released by the spin-table firmware
+   */
+  static CpuMap Default() {
+    CpuMap map;
+    for (uint64_t id = 0; id < KERNEL_CPU_COUNT; ++id) {
+      map.Add({id, arch::arm64::EnableMethod::SPIN_TABLE,
+               (BOOT_SPIN_TABLE_BASE + (id * sizeof(uint64_t)))});
+    }
+
+    return map;
+  }
+
+  /**
+   * @brief Cores described by the device tree
+   *
+   * PSCI cores use the conduit of the /psci node. Default map is used if
+   * the blob is not valid or has no cores.
+   */
+  static CpuMap FromFdt(const utils::Fdt& fdt) {
+    if (!fdt.Valid()) {
+      return Default();
+    }
+
+    const char* conduit = fdt.PsciMethod();
+    const bool smc = (nullptr != conduit) && utils::Fdt::Equal(conduit, "smc");
+    const auto psci = smc ? arch::arm64::EnableMethod::PSCI_SMC
+                          : arch::arm64::EnableMethod::PSCI_HVC;
+
+    CpuMap map;
+    fdt.ForEachCpu([&](const uint64_t id, const char* method,
+                       const uint64_t release) {
+      auto enable = arch::arm64::EnableMethod::NONE;
+      if (utils::Fdt::Equal(method, "spin-table")) {
+        enable = arch::arm64::EnableMethod::SPIN_TABLE;
+      } else if (utils::Fdt::Equal(method, "psci")) {
+        enable = psci;
+      }
+
+      map.Add({id, enable, release});
+    });
+
+    return (0 == map.Count()) ? Default() : map;
+  }
+
+ private:
+  CpuBoot cpus_[KERNEL_CPU_COUNT];
+  size_t count_;
+};
+
+}  // namespace kernel
+
+#endif  // KERNEL_CPU_MAP_H_
@@ -0,0 +1,133 @@
+/*=============================================================================
+Project Z - Operating system for ARM processors
+Copyright (C) 2018 Vladyslav Samodelok <vladfux4@gmail.com>
+All rights reserved.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+=============================================================================*/
+#include "kernel/cpus.h"
+
+#include "kernel/logger.h"
+
+namespace kernel {
+
+Cpus::Cpus(const CpuMap& map) : map_(map), locals_() {
+  const auto core = arch::arm64::Cpu::CoreId();
+  size_t index = 0;
+  for (auto& boot : map_) {
+    locals_[index] = {index, nullptr, nullptr, (boot.id == core), nullptr,
+                      nullptr};
+    if (boot.id == core) {
+      arch::arm64::Cpu::SetLocal(&locals_[index]);
+    }
+
+    index++;
+  }
+}
+
+size_t Cpus::Start(mm::Memory& memory) {
+  size_t index = 0;
+  for (auto& boot : map_) {
+    auto& local = locals_[index++];
+    if (local.online) {
+      continue;
+    }
+
+    // the boot record is shared, core which did not come up may still
+    // read it, so the rest is not released
+    if (!StartCore(memory, boot, local)) {
+      LOG(ERROR) << "Core did not start: " << boot.id;
+      break;
+    }
+  }
+
+  return Online();
+}
+
+bool Cpus::StartCore(mm::Memory& memory, const CpuBoot& boot,
+                     CpuLocal& local) {
+  using Stacks = mm::SlabAllocator<KernelStack>;
+  constexpr size_t kPageBytes =
+      mm::PageSizeInfo<mm::KERNEL_PAGE_SIZE>::in_bytes;
+
+  if (arch::arm64::EnableMethod::SPIN_TABLE == boot.method) {
+    // release address is usually in the reserved first page
+    const uint64_t page = (boot.release & ~(kPageBytes - 1));
+    memory.MapDirect(reinterpret_cast<void*>(page), kPageBytes,
+                     mm::MemoryType::RAM);
+  }
+
+  local.stack = Stacks::Make()->data;
+  if (!arch::arm64::Smp::Start(boot.method, boot.id, boot.release,
+                               (local.stack + KERNEL_STACK_SIZE), &local)) {
+    return false;
+  }
+
+  const uint64_t begin = arch::arm64::Cpu::Counter();
+  const uint64_t timeout = arch::arm64::Cpu::CounterFrequency();
+  while (!__atomic_load_n(&local.online, __ATOMIC_ACQUIRE)) {
+    if ((arch::arm64::Cpu::Counter() - begin) > timeout) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void Cpus::SetOnline() {
+  __atomic_store_n(&Local().online, true, __ATOMIC_RELEASE);
+}
+
+void Cpus::Call(CpuLocal::Function function, void* arg) {
+  auto& self = Local();
+  for (size_t i = 0; i < map_.Count(); ++i) {
+    auto& local = locals_[i];
+    if ((&local != &self) && __atomic_load_n(&local.online, __ATOMIC_ACQUIRE)) {
+      local.arg = arg;
+      __atomic_store_n(&local.call, function, __ATOMIC_RELEASE);
+    }
+  }
+
+  arch::arm64::Cpu::SendEvent();
+  function(arg);
+
+  for (size_t i = 0; i < map_.Count(); ++i) {
+    while (nullptr != __atomic_load_n(&locals_[i].call, __ATOMIC_ACQUIRE)) {
+    }
+  }
+}
+
+void Cpus::Idle() {
+  auto& local = Local();
+  while (true) {
+    // event of the posting core is kept if it comes before WFE
+    auto function = __atomic_load_n(&local.call, __ATOMIC_ACQUIRE);
+    if (nullptr == function) {
+      asm volatile("wfe");
+      continue;
+    }
+
+    function(local.arg);
+    __atomic_store_n(&local.call, nullptr, __ATOMIC_RELEASE);
+  }
+}
+
+size_t Cpus::Online() const {
+  size_t count = 0;
+  for (size_t i = 0; i < map_.Count(); ++i) {
+    count += __atomic_load_n(&locals_[i].online, __ATOMIC_ACQUIRE) ? 1 : 0;
+  }
+
+  return count;
+}
+
+}  // namespace kernel
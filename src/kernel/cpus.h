@@ -0,0 +1,103 @@
+/*=============================================================================
+Project Z - Operating system for ARM processors
+Copyright (C) 2018 Vladyslav Samodelok <vladfux4@gmail.com>
+All rights reserved.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+=============================================================================*/
+#ifndef KERNEL_CPUS_H_
+#define KERNEL_CPUS_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "arch/arm64/cpu.h"
+#include "arch/arm64/timer.h"
+#include "kernel/config.h"
+#include "kernel/cpu_map.h"
+#include "kernel/mm/memory.h"
+
+namespace kernel {
+
+/**
+ * @brief Data of one core, reached through TPIDR_EL1
+ *
+ * Blocks are cache line aligned, so cores do not share lines.
+ */
+struct alignas(64) CpuLocal {
+  using Function = void (*)(void* arg);
+
+  size_t id;                   // index of the core in the cpu map
+  uint8_t* stack;              // kernel stack, nullptr for the boot core
+  arch::arm64::Timer* timer;   // timer of the core, nullptr until created
+  bool online;
+  Function call;               // work posted to the idle core
+  void* arg;
+};
+
+/**
+ * @brief The Cores of the system
+ */
+class Cpus {
+ public:
+  struct KernelStack {
+    uint8_t data[KERNEL_STACK_SIZE];
+  };
+
+  /**
+   * @brief Constructor, sets data of the boot core
+   */
+  explicit Cpus(const CpuMap& map);
+
+  /**
+   * @brief Get data of the core which executes the code
+   */
+  static CpuLocal& Local() {
+    return *reinterpret_cast<CpuLocal*>(arch::arm64::Cpu::Local());
+  }
+
+  /**
+   * @brief Release secondary cores one by one, each is waited to come
+   *        online before the next one is released
+   *
+   * @return number of online cores
+   */
+  size_t Start(mm::Memory& memory);
+
+  /**
+   * @brief Mark the core which executes the code online
+   */
+  static void SetOnline();
+
+  /**
+   * @brief Run function on all online cores, the calling one included,
+   *        returns when all of them have finished
+   */
+  void Call(CpuLocal::Function function, void* arg);
+
+  /**
+   * @brief Wait for calls posted to the core, does not return
+   */
+  static void Idle();
+
+  size_t Online() const;
+
+ private:
+  bool StartCore(mm::Memory& memory, const CpuBoot& boot, CpuLocal& local);
+
+  CpuMap map_;
+  CpuLocal locals_[KERNEL_CPU_COUNT];
+};
+
+}  // namespace kernel
+
+#endif  // KERNEL_CPUS_H_
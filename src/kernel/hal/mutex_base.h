@@ -17,11 +17,15 @@ GNU General Public License for more details.
 #ifndef KERNEL_HAL_MUTEX_BASE_H_
 #define KERNEL_HAL_MUTEX_BASE_H_
 
+#include <cstdint>
+
 namespace kernel {
 namespace hal {
 
 /**
  * @brief The Mutex base class
+ *
+ * T is the lock algorithm, e.g. spin, ticket or MCS lock of the arch.
  */
 template <class T>
 class MutexBase {
@@ -36,10 +40,88 @@ class MutexBase {
    */
   inline void Unlock() { raw_.Unlock(); }
 
+  /**
+   * @brief Mask IRQ of the core and lock, so the IRQ handler of the core
+   *        can not spin on the lock held by the code it interrupted
+   *
+   * @return interrupt mask state to be passed to UnlockIrqRestore
+   */
+  inline uint64_t LockIrqSave() {
+    const uint64_t flags = T::SaveIrq();
+    raw_.Lock();
+    return flags;
+  }
+
+  /**
+   * @brief Unlock and restore interrupt mask state
+   */
+  inline void UnlockIrqRestore(const uint64_t flags) {
+    raw_.Unlock();
+    T::RestoreIrq(flags);
+  }
+
+  /**
+   * @brief Mask IRQ of the core without locking
+   */
+  static inline uint64_t SaveIrq() { return T::SaveIrq(); }
+
+  static inline void RestoreIrq(const uint64_t flags) { T::RestoreIrq(flags); }
+
  private:
   T raw_;
 };
 
+/**
+ * @brief The Lock guard, holds the mutex for the scope
+ */
+template <class Mutex>
+class LockGuard {
+ public:
+  explicit LockGuard(Mutex& mutex) : mutex_(mutex) { mutex_.Lock(); }
+  ~LockGuard() { mutex_.Unlock(); }
+
+  LockGuard(const LockGuard&) = delete;
+  LockGuard& operator=(const LockGuard&) = delete;
+
+ private:
+  Mutex& mutex_;
+};
+
+/**
+ * @brief The IRQ-save lock guard, holds the mutex with IRQ masked
+ */
+template <class Mutex>
+class IrqSaveGuard {
+ public:
+  explicit IrqSaveGuard(Mutex& mutex)
+      : mutex_(mutex), flags_(mutex_.LockIrqSave()) {}
+  ~IrqSaveGuard() { mutex_.UnlockIrqRestore(flags_); }
+
+  IrqSaveGuard(const IrqSaveGuard&) = delete;
+  IrqSaveGuard& operator=(const IrqSaveGuard&) = delete;
+
+ private:
+  Mutex& mutex_;
+  const uint64_t flags_;
+};
+
+/**
+ * @brief The IRQ guard, masks IRQ of the core for the scope, so data of
+ *        the core is not changed by its IRQ handler
+ */
+template <class Mutex>
+class IrqGuard {
+ public:
+  IrqGuard() : flags_(Mutex::SaveIrq()) {}
+  ~IrqGuard() { Mutex::RestoreIrq(flags_); }
+
+  IrqGuard(const IrqGuard&) = delete;
+  IrqGuard& operator=(const IrqGuard&) = delete;
+
+ private:
+  const uint64_t flags_;
+};
+
 }  // namespace hal
 }  // namespace kernel
 
@@ -20,6 +20,8 @@ GNU General Public License for more details.
 
 #include <cstddef>
 
+#include "arch/arm64/mutex.h"
+#include "kernel/boot_profiler.h"
 #include "kernel/logger.h"
 #include "kernel/mm/unique_ptr.h"
 
@@ -93,14 +95,46 @@ namespace kernel {
 
 static uint8_t __attribute__((aligned(4096))) kernel_storage[sizeof(Kernel)];
 
-Kernel::Kernel()
+/**
+ * @brief Contention of one lock by all online cores
+ */
+template <class Lock>
+struct LockBenchmark {
+  static constexpr size_t kIterations = 100000;
+
+  static void Run(void* arg) {
+    auto& benchmark = *reinterpret_cast<LockBenchmark*>(arg);
+    for (size_t i = 0; i < kIterations; ++i) {
+      benchmark.lock.Lock();
+      benchmark.counter++;
+      benchmark.lock.Unlock();
+    }
+  }
+
+  static void Log(Cpus& cpus, const char* name) {
+    LockBenchmark benchmark;
+    const uint64_t begin = arch::arm64::Cpu::Counter();
+    cpus.Call(&Run, &benchmark);
+    const uint64_t ticks = (arch::arm64::Cpu::Counter() - begin);
+    LOG(INFO) << "Lock: " << name << " ticks: " << ticks
+              << " ticks per 1000 locks: " << (ticks * 1000 / benchmark.counter)
+              << " counter: " << benchmark.counter;
+  }
+
+  hal::MutexBase<Lock> lock;
+  uint64_t counter = 0;
+};
+
+Kernel::Kernel(const mm::MemoryMap& map, const CpuMap& cpus)
     : exceptions_(),
-      memory_() {
-//      scheduler_(memory_),
+      memory_(map),
+      cpus_(cpus),
+      scheduler_(memory_) {
+  StaticMemory::Make(memory_);
+  StaticScheduler::Make(scheduler_);
 //      sys_timer_(*this),
 //      supervisor_(*this) {
-//  StaticScheduler::Make(scheduler_);
-//  StaticSysTimer::Make(sys_timer_);
+//  Cpus::Local().timer = &sys_timer_;
 //  StaticSupervisor::Make(supervisor_);
 }
 
@@ -108,9 +142,18 @@ Kernel::~Kernel() {}
 
 void Kernel::Routine() {
   LOG(INFO) << "Init";
-  kernel::mm::StaticPagePool::Value().LogInfo();
+  kernel::mm::StaticZones::Value().LogInfo();
   kernel::mm::PageSlabAllocatorBase::LogInfo();
 
+  LOG(INFO) << "Online cores: " << cpus_.Start(memory_);
+  BootProfiler::Mark("secondary cores");
+
+  if constexpr (KERNEL_LOCK_BENCHMARK) {
+    LockBenchmark<arch::arm64::SpinLock>::Log(cpus_, "spin");
+    LockBenchmark<arch::arm64::TicketLock>::Log(cpus_, "ticket");
+    LockBenchmark<arch::arm64::McsLock>::Log(cpus_, "mcs");
+  }
+
   {
     LOG(INFO) << "Run";
     auto region_1 = memory_.CreatePagedRegion(2);
@@ -124,7 +167,7 @@ void Kernel::Routine() {
       SH::INNER_SHAREABLE, AF::IGNORE, Contiguous::OFF, XN::EXECUTE
     };
 
-    void* ptr = region_1->Pages().Begin().Value();
+    void* ptr = region_1->Blocks().Begin().Value().begin;
     LOG(INFO) << "Region first page: " << ptr;
 
     address_space_1->MapRegion(reinterpret_cast<void*>(0xFFFFFFFFFFF00000),
@@ -154,7 +197,44 @@ void Kernel::Routine() {
       *v_ptr = 0xDDDDDDDDDDDDDDDD;
     }
 
-    kernel::mm::StaticPagePool::Value().LogInfo();
+    {
+      // writes to the copy-on-write region do not reach the other space
+      auto region_2 = memory_.CreatePagedRegion(4);
+      uint64_t* original =
+          reinterpret_cast<uint64_t*>(region_2->Blocks().Begin().Value().begin);
+      *original = 0x1111111111111111;
+
+      address_space_1->MapRegionCow(reinterpret_cast<void*>(0xFFFFFFFFFFD00000),
+                                    region_2, attr);
+      address_space_2->MapRegionCow(reinterpret_cast<void*>(0xFFFFFFFFFFD00000),
+                                    region_2, attr);
+
+      uint64_t* v_ptr = reinterpret_cast<uint64_t*>(0xFFFFFFFFFFD00000);
+      memory_.Select(*address_space_1);
+      *v_ptr = 0x2222222222222222;
+      memory_.Select(*address_space_2);
+      *v_ptr = 0x3333333333333333;
+
+      // space 2 is the last sharer, it writes to the original page
+      LOG(INFO) << "Cow space 2: " << *v_ptr << " original: " << *original;
+      memory_.Select(*address_space_1);
+      LOG(INFO) << "Cow space 1: " << *v_ptr;
+    }
+
+    {
+      // only touched pages of the lazy region are allocated
+      auto lazy_region = memory_.CreateLazyRegion(256);
+      address_space_1->MapRegion(reinterpret_cast<void*>(0xFFFFFFFFFFE00000),
+                                 lazy_region, attr);
+      memory_.Select(*address_space_1);
+
+      uint64_t* v_ptr = reinterpret_cast<uint64_t*>(0xFFFFFFFFFFE80008);
+      LOG(INFO) << "Lazy page value: " << *v_ptr;
+      *v_ptr = 0xEEEEEEEEEEEEEEEE;
+      LOG(INFO) << "Lazy region touched pages: " << lazy_region->Touched();
+    }
+
+    kernel::mm::StaticZones::Value().LogInfo();
     kernel::mm::PageSlabAllocatorBase::LogInfo();
   }
   {
@@ -166,7 +246,7 @@ void Kernel::Routine() {
 //    process_2->AddressSpace().MapNewPage(
 //        reinterpret_cast<void*>(0xFFFFFF8000000000));
 
-//    scheduler_.enabled = true;
+//    scheduler_.Enable();
 //    sys_timer_.Enable();
 //    exceptions_.EnableIrq();
 
@@ -191,6 +271,18 @@ void Kernel::Routine() {
 //                   kernel::mm::PagePool::Get()->FreeSlots());
 }
 
+void Kernel::SecondaryRoutine(CpuLocal& local) {
+  memory_.StartCore();
+  exceptions_.Install();
+  arch::arm64::Timer timer(*this);
+  local.timer = &timer;
+
+  // logger is not shared yet, the boot core waits for the online mark
+  LOG(INFO) << "Core online: " << local.id;
+  Cpus::SetOnline();
+  Cpus::Idle();
+}
+
 void Kernel::HandleTimer() {
 //  exceptions_.EnableIrq();
 //  scheduler_.Tick();
@@ -202,17 +294,48 @@ void Kernel::HandleSvc() { /*scheduler_.Tick()*/; }
 
 extern "C" {
 
-void KernelEntry() {
+void KernelEntry(const void* fdt, const uint64_t boot_ticks,
+                 const uint64_t mmu_ticks) {
+  BootProfiler::Start(boot_ticks);
   log::InitPrint();
+  BootProfiler::LogFrequency();
+  BootProfiler::Mark("boot mmu", mmu_ticks);
+  BootProfiler::Mark("print");
+
+  // blob is not kept, it can be overwritten once the memory map is built
+  const utils::Fdt blob(fdt);
+  LOG(INFO) << "Device tree: " << fdt << " valid: " << blob.Valid();
+  const auto map = mm::MemoryMap::FromFdt(blob);
+  const auto cpus = CpuMap::FromFdt(blob);
+  for (auto& range : map) {
+    LOG(INFO) << "Memory range: " << reinterpret_cast<void*>(range.base)
+              << " length: " << range.length
+              << " type: " << static_cast<int>(range.type);
+  }
+  if (0 != map.Dropped()) {
+    LOG(ERROR) << "Memory map is full, RAM dropped: " << map.Dropped();
+  }
+  for (auto& cpu : cpus) {
+    LOG(INFO) << "Cpu: " << cpu.id
+              << " method: " << static_cast<int>(cpu.method)
+              << " release: " << reinterpret_cast<void*>(cpu.release);
+  }
+  BootProfiler::Mark("device tree");
 
-  auto kernel = new (reinterpret_cast<Kernel*>(kernel_storage)) Kernel();
+  auto kernel =
+      new (reinterpret_cast<Kernel*>(kernel_storage)) Kernel(map, cpus);
   kernel->Routine();
   kernel->~Kernel();
 
   LOG(INFO) << "Finish";
-  kernel::mm::StaticPagePool::Value().LogInfo();
+  kernel::mm::StaticZones::Value().LogInfo();
   kernel::mm::PageSlabAllocatorBase::LogInfo();
 }
+
+void SecondaryEntry(CpuLocal* local) {
+  arch::arm64::Cpu::SetLocal(local);
+  reinterpret_cast<Kernel*>(kernel_storage)->SecondaryRoutine(*local);
+}
 }
 
 }  // namespace kernel
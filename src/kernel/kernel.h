@@ -20,6 +20,7 @@ GNU General Public License for more details.
 #include "arch/arm64/exceptions.h"
 #include "arch/arm64/timer.h"
 
+#include "kernel/cpus.h"
 #include "kernel/mm/memory.h"
 #include "kernel/scheduler/scheduler.h"
 #include "kernel/utils/static_wrapper.h"
@@ -43,7 +44,7 @@ class Supervisor {
 class Kernel : public arch::arm64::Timer::Handler {
  public:
   using StaticScheduler = utils::StaticWrapper<scheduler::Scheduler>;
-  using StaticSysTimer = utils::StaticWrapper<arch::arm64::Timer>;
+  using StaticMemory = utils::StaticWrapper<mm::Memory>;
 
   using KernelSupervisor = Supervisor<Kernel>;
   using StaticSupervisor = utils::StaticWrapper<KernelSupervisor>;
@@ -51,13 +52,18 @@ class Kernel : public arch::arm64::Timer::Handler {
   /**
    * @brief Constructor
    */
-  Kernel();
+  Kernel(const mm::MemoryMap& map, const CpuMap& cpus);
 
   /**
    * @brief Run
    */
   void Routine();
 
+  /**
+   * @brief Run on secondary core, does not return
+   */
+  void SecondaryRoutine(CpuLocal& local);
+
   void HandleTimer() override;
   void HandleSvc();
 
@@ -70,7 +76,8 @@ class Kernel : public arch::arm64::Timer::Handler {
 
   arch::arm64::Exceptions exceptions_;
   mm::Memory memory_;
-//  scheduler::Scheduler scheduler_;
+  Cpus cpus_;
+  scheduler::Scheduler scheduler_;
 //  arch::arm64::Timer sys_timer_;
 //  KernelSupervisor supervisor_;
 };
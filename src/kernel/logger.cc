@@ -16,6 +16,8 @@ GNU General Public License for more details.
 =============================================================================*/
 #include "kernel/logger.h"
 
+#include "arch/arm64/cpu.h"
+
 // print code
 extern "C" {
 
@@ -63,8 +65,9 @@ extern "C" {
 
 int mbox_call(unsigned char ch);
 
-/* mailbox message buffer */
-volatile static unsigned int __attribute__((aligned(16))) mbox[36];
+/* mailbox message buffer, cacheable since the boot map is on, so it owns
+ * whole cache lines and is kept coherent with VideoCore by hand */
+volatile static unsigned int __attribute__((aligned(64))) mbox[48];
 
 #define VIDEOCORE_MBOX (MMIO_BASE + 0x0000B880)
 #define MBOX_READ ((volatile unsigned int*)(VIDEOCORE_MBOX + 0x0))
@@ -86,6 +89,8 @@ int mbox_call(unsigned char ch) {
   do {
     asm volatile("nop");
   } while (*MBOX_STATUS & MBOX_FULL);
+  /* VideoCore reads the message from memory */
+  arch::arm64::Cpu::CleanToPoc(mbox, sizeof(mbox));
   /* write the address of our message to the mailbox with channel identifier */
   *MBOX_WRITE = r;
   /* now wait for the response */
@@ -95,8 +100,11 @@ int mbox_call(unsigned char ch) {
       asm volatile("nop");
     } while (*MBOX_STATUS & MBOX_EMPTY);
     /* is it a response to our message? */
-    if (r == *MBOX_READ) /* is it a valid successful response? */
+    if (r == *MBOX_READ) { /* is it a valid successful response? */
+      /* drop lines fetched before VideoCore wrote the response */
+      arch::arm64::Cpu::InvalidateToPoc(mbox, sizeof(mbox));
       return mbox[1] == MBOX_RESPONSE;
+    }
   }
   return 0;
 }
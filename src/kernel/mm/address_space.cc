@@ -0,0 +1,132 @@
+/*=============================================================================
+Project Z - Operating system for ARM processors
+Copyright (C) 2018 Vladyslav Samodelok <vladfux4@gmail.com>
+All rights reserved.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+=============================================================================*/
+#include "kernel/mm/address_space.h"
+
+namespace kernel {
+namespace mm {
+
+AddressSpace::~AddressSpace() {
+  LOG(DEBUG) << "~AddressSpace";
+
+  // the space stops sharing pages which it did not copy
+  for (auto it = cow_regions_.Begin(); it != cow_regions_.End(); it++) {
+    auto& region = it.Value().region;
+    std::size_t index = 0;
+    for (auto block = region->Blocks().Begin(); block != region->Blocks().End();
+         block++) {
+      for (std::size_t page = 0; page < block.Value().Count(); ++page, ++index) {
+        cow_pages_.Unshare(region.Get(), index, block.Value().begin + page);
+      }
+    }
+  }
+}
+
+bool AddressSpace::MapRegionCow(void* begin, PagedRegion::Sptr& region,
+                                const Region::Attributes& attr) {
+  if (region->Written()) {
+    LOG(ERROR) << "Region can not be shared after it was written: " << begin;
+    return false;
+  }
+
+  Region::Attributes read_only = attr;
+  read_only.s2ap = arch::arm64::mm::S2AP::NO_WRITE;
+  arch::arm64::mm::AddressSpace::MapRegion(begin, region, read_only);
+
+  for (auto it = region->Blocks().Begin(); it != region->Blocks().End(); it++) {
+    auto& block = it.Value();
+    for (std::size_t page = 0; page < block.Count(); ++page) {
+      cow_pages_.Share(block.begin + page);
+    }
+  }
+
+  cow_regions_.Push({begin, region, attr});
+  return true;
+}
+
+bool AddressSpace::HandleFault(const arch::arm64::mm::Fault& fault) {
+  const auto address = reinterpret_cast<uintptr_t>(fault.address);
+  if (arch::arm64::mm::FaultType::TRANSLATION == fault.type) {
+    return HandleLazyFault(address);
+  }
+
+  if ((arch::arm64::mm::FaultType::PERMISSION == fault.type) && fault.write) {
+    return HandleCowFault(address);
+  }
+
+  return false;
+}
+
+bool AddressSpace::HandleLazyFault(const uintptr_t address) {
+  for (auto it = lazy_regions_.Begin(); it != lazy_regions_.End(); it++) {
+    auto& joint = it.Value();
+    const auto begin = reinterpret_cast<uintptr_t>(joint.begin);
+    if ((address < begin) || (address >= (begin + joint.region->Length()))) {
+      continue;
+    }
+
+    const std::size_t index = ((address - begin) / sizeof(LazyRegion::Page));
+    auto page = joint.region->Touch(index);
+    if (nullptr == page) {
+      return false;
+    }
+
+    MapPage(reinterpret_cast<void*>(begin + (index * sizeof(LazyRegion::Page))),
+            page, joint.attr);
+    return true;
+  }
+
+  return false;
+}
+
+bool AddressSpace::HandleCowFault(const uintptr_t address) {
+  using Page = PagedRegion::Page;
+
+  for (auto it = cow_regions_.Begin(); it != cow_regions_.End(); it++) {
+    auto& joint = it.Value();
+    const auto begin = reinterpret_cast<uintptr_t>(joint.begin);
+    if ((address < begin) || (address >= (begin + joint.region->Length()))) {
+      continue;
+    }
+
+    const std::size_t index = ((address - begin) / sizeof(Page));
+    auto v_page = reinterpret_cast<void*>(begin + (index * sizeof(Page)));
+    Page* original = joint.region->PageAt(index);
+    auto copy = reinterpret_cast<Page*>(
+        cow_pages_.Write(joint.region.Get(), index, original));
+
+    if (nullptr == copy) {
+      LOG(ERROR) << "Failed to allocate copy of page: " << original;
+      return false;
+    }
+
+    if (original == copy) {
+      joint.region->MarkWritten();
+      Protect(v_page, sizeof(Page), joint.attr);
+      LOG(DEBUG) << "cow take v: " << v_page << " -> p: " << original;
+      return true;
+    }
+
+    RemapPage(v_page, copy, joint.attr);
+    LOG(DEBUG) << "cow copy v: " << v_page << " -> p: " << copy;
+    return true;
+  }
+
+  return false;
+}
+
+}  // namespace mm
+}  // namespace kernel
@@ -2,8 +2,10 @@
 #define KERNEL_MM_ADDRESS_SPACE_H_
 
 #include "arch/arm64/mm/address_space.h"
+#include "arch/arm64/mm/fault.h"
 #include "kernel/config.h"
 #include "kernel/logger.h"
+#include "kernel/mm/cow_pages.h"
 #include "kernel/mm/physical_allocator.h"
 #include "kernel/mm/region.h"
 #include "kernel/mm/unique_ptr.h"
@@ -15,9 +17,7 @@ class AddressSpace : public arch::arm64::mm::AddressSpace {
  public:
   using Uptr = kernel::mm::UniquePointer<AddressSpace, SlabAllocator>;
 
-  ~AddressSpace() {
-    LOG(DEBUG) << "~AddressSpace";
-  }
+  ~AddressSpace();
 
   template<class RegionType>
   struct RegionJoint {
@@ -36,10 +36,41 @@ class AddressSpace : public arch::arm64::mm::AddressSpace {
     direct_regions_.Push({begin, region, attr});
   }
 
+  /**
+   * @brief Reserve range for region, pages are mapped by HandleFault
+   */
+  void MapRegion(void* begin, LazyRegion::Sptr& region, const Region::Attributes& attr) {
+    lazy_regions_.Push({begin, region, attr});
+  }
+
+  /**
+   * @brief Map region read-only, a write copies the faulting page
+   *
+   * Region is shared by several spaces, the last sharer of a page takes
+   * the original page instead of copying it. Taken page is writable in its
+   * space, so the region can not be shared again once a page is taken.
+   *
+   * @return false if the region is rejected, nothing is mapped then
+   */
+  bool MapRegionCow(void* begin, PagedRegion::Sptr& region, const Region::Attributes& attr);
+
+  /**
+   * @brief Back translation fault in lazy region by page, copy page on
+   *        write to copy-on-write region
+   *
+   * Returns false if the fault does not belong to the space.
+   */
+  bool HandleFault(const arch::arm64::mm::Fault& fault);
+
  private:
   utils::List<RegionJoint<DirectRegion>, SlabAllocator> direct_regions_;
   utils::List<RegionJoint<PagedRegion>, SlabAllocator> paged_regions_;
+  bool HandleLazyFault(const uintptr_t address);
+  bool HandleCowFault(const uintptr_t address);
 
+  utils::List<RegionJoint<LazyRegion>, SlabAllocator> lazy_regions_;
+  utils::List<RegionJoint<PagedRegion>, SlabAllocator> cow_regions_;
+  CowPages<ZonePages, SlabAllocator> cow_pages_;
 };
 
 }  // namespace mm
@@ -0,0 +1,416 @@
+/*=============================================================================
+Project Z - Operating system for ARM processors
+Copyright (C) 2018 Vladyslav Samodelok <vladfux4@gmail.com>
+All rights reserved.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+=============================================================================*/
+#ifndef KERNEL_MM_BITMAP_POOL_H_
+#define KERNEL_MM_BITMAP_POOL_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace kernel {
+namespace mm {
+
+/**
+ * @brief The bitmap index pool
+ *
+ * One bit per index, set bit means free index. Two summary bitmaps keep
+ * one bit per bitmap word: word has any free index and word is fully free.
+ * Searches walk the summaries with count trailing zeros (rbit + clz), so
+ * the first free index or a free run is found without scanning the whole
+ * bitmap.
+ */
+template <class Index>
+class BitmapIndexPool {
+ public:
+  using Word = uint64_t;
+
+  static constexpr Index kNoIndex = static_cast<Index>(-1);
+  static constexpr std::size_t kWordBits = (sizeof(Word) * 8);
+  static constexpr Word kFullWord = static_cast<Word>(-1);
+
+  static constexpr std::size_t WordCount(const std::size_t bits) {
+    return ((bits + kWordBits - 1) / kWordBits);
+  }
+
+  /**
+   * @brief Get size of bitmap and summaries in words
+   */
+  static constexpr std::size_t BufferSize(const Index size) {
+    return (WordCount(size) + (2 * WordCount(WordCount(size))));
+  }
+
+  BitmapIndexPool(Word* buffer, Index size)
+      : size_(0), free_items_(0), words_(0), bits_(buffer),
+        any_(nullptr), full_(nullptr) {
+    Init(size);
+  }
+
+  ~BitmapIndexPool() {}
+
+  Index Allocate(const uint8_t order = 0) {
+    const Index count = (static_cast<Index>(1) << order);
+    return AllocateRun(count, count);
+  }
+
+  void Deallocate(const Index index, const uint8_t order = 0) {
+    DeallocateRun(index, (static_cast<Index>(1) << order));
+  }
+
+  /**
+   * @brief Allocate run of count indexes, first index is aligned to align
+   */
+  Index AllocateRun(const Index count, const Index align = 1) {
+    if ((0 == count) || (count > free_items_)) {
+      return kNoIndex;
+    }
+
+    Index index = kNoIndex;
+    if ((1 == count) && (1 == align)) {
+      index = FindFirst();
+    } else if ((count <= kWordBits) && (align <= kWordBits)) {
+      index = FindShortRun(count, align);
+    } else {
+      index = FindLongRun(count, align);
+    }
+
+    if (kNoIndex != index) {
+      SetRange(index, count, false);
+      free_items_ -= count;
+    }
+
+    return index;
+  }
+
+  void DeallocateRun(const Index index, const Index count) {
+    SetRange(index, count, true);
+    free_items_ += count;
+  }
+
+  void Cut(const Index size) {
+    if ((size < size_) && (free_items_ == size_)) {
+      Init(size);
+    }
+  }
+
+  bool IsFree(const Index index) const {
+    return (0 != (bits_[index / kWordBits] & Bit(index % kWordBits)));
+  }
+
+  /**
+   * @brief Count free aligned blocks of 2^order indexes, walks whole bitmap
+   */
+  Index FreeBlocks(const uint8_t order) const {
+    const std::size_t count = (static_cast<std::size_t>(1) << order);
+    Index blocks = 0;
+    if (count <= kWordBits) {
+      const Word align_mask = AlignMask(count);
+      for (std::size_t word = 0; word < words_; ++word) {
+        blocks += __builtin_popcountll(RunStarts(bits_[word], count) &
+                                       align_mask);
+      }
+    } else {
+      const std::size_t needed = (count / kWordBits);
+      for (std::size_t word = 0; (word + needed) <= words_; word += needed) {
+        std::size_t run = 0;
+        while ((run < needed) && (kFullWord == bits_[word + run])) {
+          run++;
+        }
+
+        blocks += (run == needed) ? 1 : 0;
+      }
+    }
+
+    return blocks;
+  }
+
+  Index Size() const { return size_; }
+  Index FreeSlots() const { return free_items_; }
+  bool Empty() const { return Size() == FreeSlots(); }
+
+ protected:
+  static constexpr Word Bit(const std::size_t position) {
+    return (static_cast<Word>(1) << position);
+  }
+
+  // mask of bits from position to the end of word
+  static constexpr Word MaskFrom(const std::size_t position) {
+    return (position >= kWordBits) ? 0 : (kFullWord << position);
+  }
+
+  // mask of count bits from position
+  static constexpr Word MaskRange(const std::size_t position,
+                                  const std::size_t count) {
+    return (count >= kWordBits) ? MaskFrom(position)
+                                : ((Bit(count) - 1) << position);
+  }
+
+  static constexpr Word AlignMask(const std::size_t align) {
+    Word mask = 0;
+    for (std::size_t i = 0; i < kWordBits; i += align) {
+      mask |= Bit(i);
+    }
+
+    return mask;
+  }
+
+  static std::size_t TrailingZeros(const Word word) {
+    return __builtin_ctzll(word);
+  }
+
+  static std::size_t LeadingOnes(const Word word) {
+    return (kFullWord == word) ? kWordBits : __builtin_clzll(~word);
+  }
+
+  static std::size_t TrailingOnes(const Word word) {
+    return (kFullWord == word) ? kWordBits : __builtin_ctzll(~word);
+  }
+
+  // bits where a run of count set bits starts, runs do not cross the word
+  static Word RunStarts(Word word, const std::size_t count) {
+    std::size_t length = 1;
+    while ((length < count) && (0 != word)) {
+      const std::size_t shift =
+          ((count - length) < length) ? (count - length) : length;
+      word &= (word >> shift);
+      length += shift;
+    }
+
+    return word;
+  }
+
+  void Init(const Index size) {
+    const std::size_t summary_words = WordCount(WordCount(size));
+
+    size_ = size;
+    free_items_ = size;
+    words_ = WordCount(size);
+    any_ = (bits_ + words_);
+    full_ = (any_ + summary_words);
+
+    for (std::size_t i = 0; i < words_; ++i) {
+      bits_[i] = kFullWord;
+    }
+
+    if (0 != (size_ % kWordBits)) {
+      bits_[words_ - 1] = MaskRange(0, (size_ % kWordBits));
+    }
+
+    for (std::size_t i = 0; i < summary_words; ++i) {
+      any_[i] = 0;
+      full_[i] = 0;
+    }
+
+    for (std::size_t i = 0; i < words_; ++i) {
+      UpdateSummary(i);
+    }
+  }
+
+  void UpdateSummary(const std::size_t word) {
+    const std::size_t summary = (word / kWordBits);
+    const Word bit = Bit(word % kWordBits);
+
+    any_[summary] = (0 != bits_[word]) ? (any_[summary] | bit)
+                                       : (any_[summary] & ~bit);
+    full_[summary] = (kFullWord == bits_[word]) ? (full_[summary] | bit)
+                                                : (full_[summary] & ~bit);
+  }
+
+  void SetRange(const Index index, const Index count, const bool free) {
+    std::size_t word = (index / kWordBits);
+    std::size_t position = (index % kWordBits);
+    std::size_t left = count;
+
+    while (0 != left) {
+      const std::size_t length =
+          ((kWordBits - position) < left) ? (kWordBits - position) : left;
+      const Word mask = MaskRange(position, length);
+      bits_[word] = free ? (bits_[word] | mask) : (bits_[word] & ~mask);
+      UpdateSummary(word);
+
+      left -= length;
+      position = 0;
+      word++;
+    }
+  }
+
+  // first word at or after from marked in summary
+  std::size_t NextWord(const Word* summary, const std::size_t from) const {
+    const std::size_t summary_words = WordCount(words_);
+    std::size_t index = (from / kWordBits);
+    if (index >= summary_words) {
+      return words_;
+    }
+
+    Word word = (summary[index] & MaskFrom(from % kWordBits));
+    while (0 == word) {
+      index++;
+      if (index >= summary_words) {
+        return words_;
+      }
+
+      word = summary[index];
+    }
+
+    return ((index * kWordBits) + TrailingZeros(word));
+  }
+
+  Index FindFirst() const {
+    const std::size_t word = NextWord(any_, 0);
+    if (word >= words_) {
+      return kNoIndex;
+    }
+
+    return static_cast<Index>((word * kWordBits) + TrailingZeros(bits_[word]));
+  }
+
+  Index FindShortRun(const Index count, const Index align) const {
+    const Word align_mask = AlignMask(align);
+
+    for (std::size_t word = NextWord(any_, 0); word < words_;
+         word = NextWord(any_, word + 1)) {
+      const Word bits = bits_[word];
+      const Word starts = (RunStarts(bits, count) & align_mask);
+      if (0 != starts) {
+        return static_cast<Index>((word * kWordBits) + TrailingZeros(starts));
+      }
+
+      // run which continues in the next word
+      if ((word + 1) < words_) {
+        std::size_t start = (kWordBits - LeadingOnes(bits));
+        start = (((start + align - 1) / align) * align);
+        const std::size_t head = (kWordBits - start);
+        if ((start < kWordBits) && (head < count) &&
+            ((count - head) <= TrailingOnes(bits_[word + 1]))) {
+          return static_cast<Index>((word * kWordBits) + start);
+        }
+      }
+    }
+
+    return kNoIndex;
+  }
+
+  Index FindLongRun(const Index count, const Index align) const {
+    // run longer than a word covers the free top bits of its first word,
+    // run aligned beyond a word starts at a word boundary
+    const std::size_t word_align =
+        (align > kWordBits) ? (align / kWordBits) : 1;
+
+    std::size_t word = NextWord(any_, 0);
+    while (word < words_) {
+      if (0 != (word % word_align)) {
+        word = NextWord(any_, ((word / word_align) + 1) * word_align);
+        continue;
+      }
+
+      std::size_t start = 0;
+      if (align <= kWordBits) {
+        start = (kWordBits - LeadingOnes(bits_[word]));
+        start = (((start + align - 1) / align) * align);
+      }
+
+      if ((start < kWordBits) && IsRunFree(word, start, count)) {
+        return static_cast<Index>((word * kWordBits) + start);
+      }
+
+      word = NextWord(any_, word + 1);
+    }
+
+    return kNoIndex;
+  }
+
+  bool IsRunFree(std::size_t word, const std::size_t start,
+                 const std::size_t count) const {
+    const std::size_t head = (kWordBits - start);
+    if (count <= head) {
+      const Word mask = MaskRange(start, count);
+      return (mask == (bits_[word] & mask));
+    }
+
+    if (MaskFrom(start) != (bits_[word] & MaskFrom(start))) {
+      return false;
+    }
+
+    std::size_t left = (count - head);
+    for (word++; left >= kWordBits; word++, left -= kWordBits) {
+      if ((word >= words_) || (kFullWord != bits_[word])) {
+        return false;
+      }
+    }
+
+    return (0 == left) ||
+           ((word < words_) && (left <= TrailingOnes(bits_[word])));
+  }
+
+  Index size_;
+  Index free_items_;
+  std::size_t words_;
+  Word* bits_;
+  Word* any_;
+  Word* full_;
+};
+
+template <class T, class Index, template <class, size_t = 0> class AllocatorBase>
+class BitmapPool : public BitmapIndexPool<Index> {
+ public:
+  using IndexPoolType = BitmapIndexPool<Index>;
+  using Word = typename IndexPoolType::Word;
+  using WordAllocator = AllocatorBase<Word, sizeof(Word)>;
+  using TypeAllocator = AllocatorBase<T>;
+
+  BitmapPool(const Index size)
+      : IndexPoolType(WordAllocator::Allocate(IndexPoolType::BufferSize(size)),
+                      size),
+        buffer_(TypeAllocator::Allocate(size)) {}
+
+  ~BitmapPool() {
+    WordAllocator::Deallocate(this->bits_);
+    TypeAllocator::Deallocate(buffer_);
+  }
+
+  T* Allocate(const uint8_t order = 0) {
+    T* ret_val = nullptr;
+    auto index = IndexPoolType::Allocate(order);
+    if (IndexPoolType::kNoIndex != index) {
+      ret_val = &buffer_[index];
+    }
+
+    return ret_val;
+  }
+
+  void Deallocate(const T* item, const uint8_t order = 0) {
+    IndexPoolType::Deallocate(ToIndex(item), order);
+  }
+
+  Index AllocateByIndex(const uint8_t order = 0) {
+    return IndexPoolType::Allocate(order);
+  }
+
+  void DeallocateByIndex(const Index index, const uint8_t order = 0) {
+    IndexPoolType::Deallocate(index, order);
+  }
+
+  Index ToIndex(const T* item) { return (item - buffer_); }
+
+  T& At(const Index index) { return buffer_[index]; }
+
+ private:
+  T* buffer_;
+};
+
+}  // namespace mm
+}  // namespace kernel
+
+#endif  // KERNEL_MM_BITMAP_POOL_H_
@@ -0,0 +1,263 @@
+/*=============================================================================
+Project Z - Operating system for ARM processors
+Copyright (C) 2018 Vladyslav Samodelok <vladfux4@gmail.com>
+All rights reserved.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+=============================================================================*/
+#ifndef KERNEL_MM_BUDDY_POOL_H_
+#define KERNEL_MM_BUDDY_POOL_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace kernel {
+namespace mm {
+
+/**
+ * @brief Get order of the smallest block which fits count items
+ */
+constexpr uint8_t BlockOrder(const std::size_t count) {
+  uint8_t order = 0;
+  while ((static_cast<std::size_t>(1) << order) < count) {
+    order++;
+  }
+
+  return order;
+}
+
+/**
+ * @brief Get order of the biggest block which fits into count items
+ */
+constexpr uint8_t FloorBlockOrder(const std::size_t count) {
+  uint8_t order = 0;
+  while ((static_cast<std::size_t>(2) << order) <= count) {
+    order++;
+  }
+
+  return order;
+}
+
+static_assert(BlockOrder(1) == 0);
+static_assert(BlockOrder(512) == 9);
+static_assert(BlockOrder(513) == 10);
+static_assert(FloorBlockOrder(1) == 0);
+static_assert(FloorBlockOrder(1023) == 9);
+
+/**
+ * @brief The buddy system index pool
+ *
+ * Blocks of 2^order indexes are kept in per order free lists. Allocation
+ * splits the smallest fitting block, deallocation merges the block with its
+ * buddy while the buddy is free and of the same order.
+ *
+ * Only the head of each block carries valid data, so the initialization
+ * touches one item per seeded block instead of every index.
+ */
+template <class Index, uint8_t kMaxOrder>
+class BuddyIndexPool {
+ public:
+  struct IndexData {
+    Index next;
+    Index prev;
+    uint8_t order;
+    bool free;
+  };
+
+  static constexpr uint8_t kOrderCount = (kMaxOrder + 1);
+  static constexpr Index kNoIndex = static_cast<Index>(-1);
+
+  BuddyIndexPool(IndexData* index_list, Index size)
+      : size_(0), free_items_(0), index_list_(index_list) {
+    Init(size);
+  }
+
+  ~BuddyIndexPool() {}
+
+  Index Allocate(const uint8_t order = 0) {
+    if (order > kMaxOrder) {
+      return kNoIndex;
+    }
+
+    uint8_t current = order;
+    while ((current <= kMaxOrder) && (kNoIndex == heads_[current])) {
+      current++;
+    }
+
+    if (current > kMaxOrder) {
+      return kNoIndex;
+    }
+
+    const Index index = heads_[current];
+    Remove(index, current);
+
+    // return upper halves back to the lower order lists
+    while (current > order) {
+      current--;
+      Push(index + BlockSize(current), current);
+    }
+
+    index_list_[index].order = order;
+    free_items_ -= BlockSize(order);
+    return index;
+  }
+
+  void Deallocate(Index index, uint8_t order) {
+    free_items_ += BlockSize(order);
+
+    while (order < kMaxOrder) {
+      const Index buddy = (index ^ BlockSize(order));
+      if ((buddy + BlockSize(order)) > size_) {
+        break;
+      }
+
+      const auto& data = index_list_[buddy];
+      if ((!data.free) || (data.order != order)) {
+        break;
+      }
+
+      Remove(buddy, order);
+      index = (index & ~BlockSize(order));
+      order++;
+    }
+
+    Push(index, order);
+  }
+
+  void Cut(const Index size) {
+    if ((size < size_) && (free_items_ == size_)) {
+      Init(size);
+    }
+  }
+
+  Index Size() const { return size_; }
+  Index FreeSlots() const { return free_items_; }
+  Index FreeBlocks(const uint8_t order) const { return free_blocks_[order]; }
+  bool Empty() const { return Size() == FreeSlots(); }
+
+  static constexpr Index BlockSize(const uint8_t order) {
+    return (static_cast<Index>(1) << order);
+  }
+
+ protected:
+  void Init(const Index size) {
+    size_ = size;
+    free_items_ = size;
+
+    for (uint8_t order = 0; order <= kMaxOrder; ++order) {
+      heads_[order] = kNoIndex;
+      free_blocks_[order] = 0;
+    }
+
+    // seed the biggest aligned blocks which fit into the pool
+    Index index = 0;
+    while (index < size_) {
+      uint8_t order = kMaxOrder;
+      while ((0 != (index & (BlockSize(order) - 1))) ||
+             ((size_ - index) < BlockSize(order))) {
+        order--;
+      }
+
+      Push(index, order);
+      index += BlockSize(order);
+    }
+  }
+
+  void Push(const Index index, const uint8_t order) {
+    auto& data = index_list_[index];
+    data.next = heads_[order];
+    data.prev = kNoIndex;
+    data.order = order;
+    data.free = true;
+
+    if (kNoIndex != heads_[order]) {
+      index_list_[heads_[order]].prev = index;
+    }
+
+    heads_[order] = index;
+    free_blocks_[order]++;
+  }
+
+  void Remove(const Index index, const uint8_t order) {
+    auto& data = index_list_[index];
+    if (kNoIndex != data.prev) {
+      index_list_[data.prev].next = data.next;
+    } else {
+      heads_[order] = data.next;
+    }
+
+    if (kNoIndex != data.next) {
+      index_list_[data.next].prev = data.prev;
+    }
+
+    data.free = false;
+    free_blocks_[order]--;
+  }
+
+  Index size_;
+  Index free_items_;
+  Index heads_[kOrderCount];
+  Index free_blocks_[kOrderCount];
+  IndexData* index_list_;
+};
+
+template <class T, class Index, uint8_t kMaxOrder,
+          template <class, size_t = 0> class AllocatorBase>
+class BuddyPool : public BuddyIndexPool<Index, kMaxOrder> {
+ public:
+  using IndexPoolType = BuddyIndexPool<Index, kMaxOrder>;
+  using IndexAllocator = AllocatorBase<typename IndexPoolType::IndexData>;
+  using TypeAllocator = AllocatorBase<T>;
+
+  BuddyPool(const Index size)
+      : IndexPoolType(IndexAllocator::Allocate(size), size),
+        buffer_(TypeAllocator::Allocate(size)) {}
+
+  ~BuddyPool() {
+    IndexAllocator::Deallocate(this->index_list_);
+    TypeAllocator::Deallocate(buffer_);
+  }
+
+  T* Allocate(const uint8_t order = 0) {
+    T* ret_val = nullptr;
+    auto index = IndexPoolType::Allocate(order);
+    if (IndexPoolType::kNoIndex != index) {
+      ret_val = &buffer_[index];
+    }
+
+    return ret_val;
+  }
+
+  void Deallocate(const T* item, const uint8_t order = 0) {
+    IndexPoolType::Deallocate(ToIndex(item), order);
+  }
+
+  Index AllocateByIndex(const uint8_t order = 0) {
+    return IndexPoolType::Allocate(order);
+  }
+
+  void DeallocateByIndex(const Index index, const uint8_t order = 0) {
+    IndexPoolType::Deallocate(index, order);
+  }
+
+  Index ToIndex(const T* item) { return (item - buffer_); }
+
+  T& At(const Index index) { return buffer_[index]; }
+
+ private:
+  T* buffer_;
+};
+
+}  // namespace mm
+}  // namespace kernel
+
+#endif  // KERNEL_MM_BUDDY_POOL_H_
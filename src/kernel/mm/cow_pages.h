@@ -0,0 +1,127 @@
+/*=============================================================================
+Project Z - Operating system for ARM processors
+Copyright (C) 2018 Vladyslav Samodelok <vladfux4@gmail.com>
+All rights reserved.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+=============================================================================*/
+#ifndef KERNEL_MM_COW_PAGES_H_
+#define KERNEL_MM_COW_PAGES_H_
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "kernel/mm/page_pool.h"
+#include "kernel/utils/array.h"
+
+namespace kernel {
+namespace mm {
+
+/**
+ * @brief Copy-on-write pages of one address space
+ *
+ * Shared pages count their sharers in PageInfo::cow_refs. A sharer which
+ * writes a page gets a private copy, the last sharer takes the original.
+ * Private pages are kept per (region, index) and freed with the space.
+ */
+template <class Pages, template <class, std::size_t> class Allocator>
+class CowPages {
+ public:
+  CowPages() : copies_() {}
+
+  ~CowPages() {
+    for (auto it = copies_.Begin(); it != copies_.End(); it++) {
+      if (nullptr != it.Value().page) {
+        Pages::Deallocate(it.Value().page, 0);
+      }
+    }
+  }
+
+  /**
+   * @brief Add the space to sharers of the page
+   */
+  static void Share(const void* page) { Pages::Info(page)->cow_refs++; }
+
+  /**
+   * @brief Make page private on write
+   *
+   * @return the copy, the original if it was taken over, nullptr if the
+   *         copy can not be allocated
+   */
+  void* Write(const void* region, const std::size_t index, void* original) {
+    const Copy* copy = Find(region, index);
+    if (nullptr != copy) {
+      // spurious or racing fault, the page is private already
+      return (nullptr != copy->page) ? copy->page : original;
+    }
+
+    auto info = Pages::Info(original);
+    assert(info->cow_refs > 0);
+    if (1 == info->cow_refs) {
+      // other sharers have own copies, the original is not shared anymore
+      info->cow_refs = 0;
+      copies_.Push({region, index, nullptr});
+      return original;
+    }
+
+    void* page = Pages::Allocate(0);
+    if (nullptr == page) {
+      return nullptr;
+    }
+
+    memcpy(page, original, PagePool::kPageBytes);
+    info->cow_refs--;
+    copies_.Push({region, index, page});
+    return page;
+  }
+
+  /**
+   * @brief Remove the space from sharers of the page it did not make private
+   */
+  void Unshare(const void* region, const std::size_t index, const void* page) {
+    if (!Copied(region, index)) {
+      auto info = Pages::Info(page);
+      assert(info->cow_refs > 0);
+      info->cow_refs--;
+    }
+  }
+
+  bool Copied(const void* region, const std::size_t index) {
+    return (nullptr != Find(region, index));
+  }
+
+ private:
+  struct Copy {
+    const void* region;
+    std::size_t index;
+    void* page;  // nullptr if the original page was taken
+  };
+
+  Copy* Find(const void* region, const std::size_t index) {
+    for (auto it = copies_.Begin(); it != copies_.End(); it++) {
+      if ((it.Value().region == region) && (it.Value().index == index)) {
+        return &it.Value();
+      }
+    }
+
+    return nullptr;
+  }
+
+  utils::List<Copy, Allocator> copies_;
+};
+
+}  // namespace mm
+}  // namespace kernel
+
+#endif  // KERNEL_MM_COW_PAGES_H_
@@ -14,16 +14,12 @@ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
 GNU General Public License for more details.
 
 =============================================================================*/
-#include "arch/arm64/mutex.h"
+#include "kernel/mm/heap.h"
 
-namespace arch {
-namespace arm64 {
+namespace kernel {
+namespace mm {
 
-void Mutex::Lock() {
-}
+template class HeapBase<ZonePages>;
 
-void Mutex::Unlock() {
-}
-
-}  // namespace arm64
-}  // namespace arch
+}  // namespace mm
+}  // namespace kernel
@@ -0,0 +1,197 @@
+/*=============================================================================
+Project Z - Operating system for ARM processors
+Copyright (C) 2018 Vladyslav Samodelok <vladfux4@gmail.com>
+All rights reserved.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+=============================================================================*/
+#ifndef KERNEL_MM_HEAP_H_
+#define KERNEL_MM_HEAP_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "kernel/mm/physical_allocator.h"
+#include "kernel/mm/zone.h"
+
+namespace kernel {
+namespace mm {
+
+/**
+ * @brief The general purpose kernel heap
+ *
+ * Small sizes are rounded up to power of two and 3/4 size classes, every
+ * class is one shared slab cache. Bigger sizes take a page block.
+ * Returned memory is aligned to 8 bytes, page blocks to page size.
+ */
+template <class Pages>
+class HeapBase {
+ public:
+  static constexpr size_t kMinClassSize = 16;
+  static constexpr size_t kMaxClassSize = 1536;
+  static constexpr size_t kClassCount = 14;
+  static constexpr uint8_t kNoClass = 0;
+  static constexpr uint8_t kLargeClass = 0xFF;
+
+  static void* Allocate(const size_t size) {
+    if (0 == size) {
+      return nullptr;
+    }
+
+    if (size <= kMaxClassSize) {
+      return classes_[ClassIndex(size)].allocate();
+    }
+
+    const size_t pages =
+        ((size + PagePool::kPageBytes - 1) / PagePool::kPageBytes);
+    const uint8_t order = BlockOrder(pages);
+    if (order > PagePool::kMaxOrder) {
+      LOG(ERROR) << "Heap allocation is too big: " << size;
+      return nullptr;
+    }
+
+    void* ptr = Pages::Allocate(order);
+    if (nullptr != ptr) {
+      auto info = Pages::Info(ptr);
+      info->heap_class = kLargeClass;
+      info->order = order;
+    }
+
+    return ptr;
+  }
+
+  static void Deallocate(void* ptr) {
+    if (nullptr == ptr) {
+      return;
+    }
+
+    auto info = Pages::Info(ptr);
+    if (nullptr == info) {
+      LOG(ERROR) << "Free of not heap memory: " << ptr;
+      return;
+    }
+
+    if (kLargeClass == info->heap_class) {
+      info->heap_class = kNoClass;
+      Pages::Deallocate(ptr, info->order);
+    } else if ((kNoClass != info->heap_class) &&
+               (info->heap_class <= kClassCount)) {
+      classes_[info->heap_class - 1].deallocate(ptr);
+    } else {
+      LOG(ERROR) << "Free of not heap memory: " << ptr;
+    }
+  }
+
+  /**
+   * @brief Get size class index, classes are 16, 24, 32, 48, 64 ... 1536
+   */
+  static constexpr size_t ClassIndex(const size_t size) {
+    if (size <= kMinClassSize) {
+      return 0;
+    }
+
+    const uint8_t order = BlockOrder(size);
+    size_t index = (2 * (order - BlockOrder(kMinClassSize)));
+    if (size <= ((static_cast<size_t>(3) << order) >> 2)) {
+      index--;
+    }
+
+    return index;
+  }
+
+  static constexpr size_t ClassSize(const size_t index) {
+    const size_t base = (kMinClassSize << (index / 2));
+    return (0 == (index % 2)) ? base : (base + (base / 2));
+  }
+
+ private:
+  template <size_t kSize>
+  struct __attribute__((aligned(8))) Object {
+    uint8_t data[kSize];
+  };
+
+  struct SizeClass {
+    void* (*allocate)();
+    void (*deallocate)(void*);
+  };
+
+  /**
+   * @brief Slab pages of the class, the class is kept in the page info
+   * while the page belongs to the slab cache
+   */
+  template <size_t kIndex>
+  struct ClassPages {
+    template <typename T, size_t>
+    struct Allocator {
+      static T* Allocate() {
+        void* page = Pages::Allocate(0);
+        if (nullptr != page) {
+          Pages::Info(page)->heap_class = static_cast<uint8_t>(kIndex + 1);
+        }
+
+        return reinterpret_cast<T*>(page);
+      }
+
+      static void Deallocate(T* page) {
+        Pages::Info(page)->heap_class = kNoClass;
+        Pages::Deallocate(page, 0);
+      }
+    };
+  };
+
+  template <size_t kIndex>
+  struct SizeClassOps {
+    using Type = Object<ClassSize(kIndex)>;
+    using Slab = PageSlabAllocator<Type, 0,
+                                   ClassPages<kIndex>::template Allocator>;
+
+    static void* Allocate() { return Slab::Allocate(); }
+    static void Deallocate(void* ptr) {
+      Slab::Deallocate(reinterpret_cast<Type*>(ptr));
+    }
+  };
+
+  template <size_t... I>
+  static constexpr auto MakeClasses(std::index_sequence<I...>) {
+    return std::array<SizeClass, sizeof...(I)>{
+        SizeClass{&SizeClassOps<I>::Allocate, &SizeClassOps<I>::Deallocate}...};
+  }
+
+  static const std::array<SizeClass, kClassCount> classes_;
+};
+
+template <class Pages>
+const std::array<typename HeapBase<Pages>::SizeClass,
+                 HeapBase<Pages>::kClassCount>
+    HeapBase<Pages>::classes_ = HeapBase<Pages>::MakeClasses(
+        std::make_index_sequence<HeapBase<Pages>::kClassCount>{});
+
+extern template class HeapBase<ZonePages>;
+using Heap = HeapBase<ZonePages>;
+
+static_assert(Heap::ClassIndex(1) == 0);
+static_assert(Heap::ClassIndex(17) == 1);
+static_assert(Heap::ClassIndex(24) == 1);
+static_assert(Heap::ClassIndex(25) == 2);
+static_assert(Heap::ClassIndex(1025) == (Heap::kClassCount - 1));
+static_assert(Heap::ClassSize(Heap::kClassCount - 1) == Heap::kMaxClassSize);
+static_assert(Heap::ClassSize(Heap::ClassIndex(100)) == 128);
+
+inline void* kmalloc(const size_t size) { return Heap::Allocate(size); }
+inline void kfree(void* ptr) { Heap::Deallocate(ptr); }
+
+}  // namespace mm
+}  // namespace kernel
+
+#endif  // KERNEL_MM_HEAP_H_
@@ -15,27 +15,61 @@ GNU General Public License for more details.
 
 =============================================================================*/
 #include "kernel/mm/memory.h"
+#include "arch/arm64/cpu.h"
+#include "arch/arm64/mm/boot_map.h"
+#include "kernel/boot_profiler.h"
 #include "kernel/mm/region.h"
 
 namespace kernel {
 namespace mm {
 
-Memory::Memory() : mmu_(), p_space_(nullptr) {
-  InitPagePool();
+Memory::Memory(const MemoryMap& map)
+    : map_(map), mmu_(), p_space_(nullptr), current_(nullptr) {
+  InitZones();
+  BootProfiler::Mark("zones");
   InitPhSpace();
+  BootProfiler::Mark("physical space");
 
-  Select(*p_space_);
+  mmu_.LeaveBootMap(*p_space_);
+  current_ = &*p_space_;
   mmu_.Enable();
+  CleanVcRam();
+  BootProfiler::Mark("mmu");
 }
 
 void Memory::Select(AddressSpace& space) {
   mmu_.SelectAddressSpace(space);
+  current_ = &space;
+}
+
+void Memory::StartCore() {
+  mmu_.LeaveBootMap(*p_space_);
+  mmu_.Enable();
+}
+
+void Memory::MapDirect(void* begin, const size_t length,
+                       const MemoryType type) {
+  size_t physical = 0;
+  if (p_space_->Translate(begin, physical)) {
+    return;
+  }
+
+  auto region = CreateDirectRegion(begin, length);
+  p_space_->MapRegion(begin, region, RangeAttributes(type));
+}
+
+bool Memory::HandleFault(const arch::arm64::mm::Fault& fault) {
+  return (nullptr != current_) && current_->HandleFault(fault);
 }
 
 PagedRegion::Sptr Memory::CreatePagedRegion(const size_t count) {
   return PagedRegion::Sptr::Make(count);
 }
 
+LazyRegion::Sptr Memory::CreateLazyRegion(const size_t count) {
+  return LazyRegion::Sptr::Make(count);
+}
+
 DirectRegion::Sptr Memory::CreateDirectRegion(void* begin, const size_t length)
 {
   return DirectRegion::Sptr::Make(begin, length);
@@ -46,61 +80,127 @@ AddressSpace::Uptr Memory::CreateAddressSpace()
   return AddressSpace::Uptr::Make();
 }
 
-void Memory::InitPagePool() {
-  auto init_begin = BootStack::GetHead();
-  LOG(DEBUG) << "pool init begin: " << init_begin;
-
-  size_t length = (880 * (1ULL << 20));  // 880Mb of ram
-  // minus kernel data and boot stack size
-  length = length - reinterpret_cast<size_t>(init_begin);
-  LOG(DEBUG) << "pool size: " << length;
-
-  auto page_pool = new (BootAllocator<PagePool>::Allocate()) PagePool(length);
-  StaticPagePool::Make(*page_pool);
+void Memory::InitZones() {
+  auto init_begin = reinterpret_cast<uintptr_t>(BootStack::GetHead());
+  LOG(DEBUG) << "zones init begin: " << BootStack::GetHead();
+
+  auto zones = new (BootAllocator<Zones>::Allocate()) Zones();
+  StaticZones::Make(*zones);
+
+  struct Piece {
+    ZoneType type;
+    uintptr_t begin;
+    uintptr_t end;
+    PagePool* pool;
+  };
+
+  Piece pieces[Zones::kMaxPools];
+  size_t count = 0;
+  auto add_piece = [&](const ZoneType type, const uintptr_t begin,
+                       const uintptr_t end) {
+    if (begin >= end) {
+      return;
+    }
+
+    if (count >= Zones::kMaxPools) {
+      LOG(ERROR) << "Zone piece is dropped: " << reinterpret_cast<void*>(begin)
+                 << " length: " << (end - begin);
+      return;
+    }
+
+    pieces[count++] = {type, begin, end, nullptr};
+  };
+
+  // every RAM range is split at the DMA limit, ram below kernel data and
+  // boot stack is not managed
+  for (auto& range : map_) {
+    if (MemoryType::RAM == range.type) {
+      const uintptr_t begin = (range.base > init_begin) ? range.base
+                                                        : init_begin;
+      const uintptr_t dma_end = (range.End() < KERNEL_DMA_ZONE_LIMIT)
+                                    ? range.End()
+                                    : KERNEL_DMA_ZONE_LIMIT;
+      add_piece(ZoneType::DMA, begin, dma_end);
+      add_piece(ZoneType::NORMAL,
+                (begin > KERNEL_DMA_ZONE_LIMIT) ? begin : KERNEL_DMA_ZONE_LIMIT,
+                range.End());
+    } else if (MemoryType::VC_RAM == range.type) {
+      add_piece(ZoneType::NON_CACHEABLE, range.base, range.End());
+    }
+  }
+
+  // pools metadata is allocated first to know where the free memory begins
+  for (size_t i = 0; i < count; ++i) {
+    auto pool = new (BootAllocator<PagePool>::Allocate())
+        PagePool(pieces[i].end - pieces[i].begin);
+    pool->SetReclaimHandler(&PageSlabAllocatorBase::Reclaim);
+    pieces[i].pool = pool;
+  }
+
+  // allign the stack end to the biggest page block, so blocks of max order
+  // are physically aligned for block descriptors
+  auto stack_end =
+      reinterpret_cast<uintptr_t>(BootStack::Push(1, PagePool::kMaxBlockBytes));
+  LOG(DEBUG) << "zones free begin: " << reinterpret_cast<void*>(stack_end);
+
+  for (size_t i = 0; i < count; ++i) {
+    Piece& piece = pieces[i];
+    uintptr_t begin = (piece.begin > stack_end) ? piece.begin : stack_end;
+    begin = ((begin + PagePool::kMaxBlockBytes - 1) &
+             ~(PagePool::kMaxBlockBytes - 1));
+    if (begin >= piece.end) {
+      continue;
+    }
+
+    piece.pool->SetBeginAddress(reinterpret_cast<uint8_t*>(begin));
+    piece.pool->CutBytes(piece.end - begin);
+    zones->Add(piece.type, *piece.pool,
+               Watermarks::ForPages(piece.pool->Size()));
+  }
+
+  assert(zones->Present(ZoneType::DMA));
+}
 
-  // allign the stack end to page size
-  auto begin = BootStack::Push(1, PageSizeInfo<KERNEL_PAGE_SIZE>::in_bytes);
+void Memory::CleanVcRam() {
+  // boot map has VideoCore memory of the default split only, the part
+  // below was cacheable until the kernel space replaced the boot map
+  for (auto& range : map_) {
+    const uintptr_t end =
+        (range.End() < BOOT_MAP_VC_BASE) ? range.End() : BOOT_MAP_VC_BASE;
+    if ((MemoryType::VC_RAM == range.type) && (range.base < end)) {
+      arch::arm64::Cpu::CleanToPoc(reinterpret_cast<void*>(range.base),
+                                   (end - range.base));
+    }
+  }
+}
 
-  LOG(DEBUG) << "pool new begin: " << begin;
-  StaticPagePool::Value().SetBeginAddress(begin);
+Region::Attributes Memory::RangeAttributes(const MemoryType type) {
+  using namespace arch::arm64::mm;
 
-  // minus new boot stack after pool allocation
-  length = length - (reinterpret_cast<size_t>(begin) -
-                     reinterpret_cast<size_t>(init_begin));
-  LOG(DEBUG) << "pool new size: " << length;
-  StaticPagePool::Value().CutBytes(length);
+  switch (type) {
+    case MemoryType::RAM:
+      return {MemoryAttr::NORMAL, S2AP::NORMAL, SH::INNER_SHAREABLE,
+              AF::IGNORE, Contiguous::OFF, XN::EXECUTE};
+    case MemoryType::VC_RAM:
+      return {MemoryAttr::NORMAL_NC, S2AP::NORMAL, SH::NON_SHAREABLE,
+              AF::IGNORE, Contiguous::OFF, XN::EXECUTE};
+    case MemoryType::DEVICE:
+    default:
+      return {MemoryAttr::DEVICE_NGNRNE, S2AP::NORMAL, SH::NON_SHAREABLE,
+              AF::IGNORE, Contiguous::OFF, XN::EXECUTE};
+  }
 }
 
 void Memory::InitPhSpace()
 {
   p_space_ = AddressSpace::Uptr::Make();
-  void* base = nullptr;
-  using namespace arch::arm64::mm;
+  AddressSpace::SetKernel(*p_space_);
 
-  // 880Mb of ram
-  auto ram = CreateDirectRegion(base, (880ULL << 20));
-  p_space_->MapRegion(base, ram, {MemoryAttr::NORMAL, S2AP::NORMAL,
-       SH::INNER_SHAREABLE, AF::IGNORE, Contiguous::OFF, XN::EXECUTE});
-
-  // VC ram up to 0x3F000000
-  base = reinterpret_cast<void*>((880ULL << 20));
-  auto vc_ram = CreateDirectRegion(base, (128ULL << 20));
-  p_space_->MapRegion(base, vc_ram, {MemoryAttr::NORMAL_NC, S2AP::NORMAL,
-         SH::NON_SHAREABLE, AF::IGNORE, Contiguous::OFF, XN::EXECUTE});
-
-  // 16 MB peripherals at 0x3F000000 - 0x40000000
-  base = reinterpret_cast<void*>((1008ULL << 20));
-  auto peripherals = CreateDirectRegion(base, (16ULL << 20));
-  p_space_->MapRegion(base, peripherals, {MemoryAttr::DEVICE_NGNRNE,
-         S2AP::NORMAL, SH::NON_SHAREABLE, AF::IGNORE, Contiguous::OFF,
-         XN::EXECUTE});
-
-  // 2 MB for mailboxes at 0x40000000
-  base = reinterpret_cast<void*>((1024ULL << 20));
-  auto mailboxes = CreateDirectRegion(base, (2ULL << 20));
-  p_space_->MapRegion(base, mailboxes, {MemoryAttr::DEVICE_NGNRNE,
-       S2AP::NORMAL, SH::NON_SHAREABLE, AF::IGNORE, Contiguous::OFF,
-       XN::EXECUTE});
+  for (auto& range : map_) {
+    void* base = reinterpret_cast<void*>(range.base);
+    auto region = CreateDirectRegion(base, range.length);
+    p_space_->MapRegion(base, region, RangeAttributes(range.type));
+  }
 }
 
 }  // namespace mm
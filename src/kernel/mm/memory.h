@@ -25,6 +25,7 @@ GNU General Public License for more details.
 #include "kernel/config.h"
 #include "kernel/mm/address_space.h"
 #include "kernel/mm/boot_allocator.h"
+#include "kernel/mm/memory_map.h"
 #include "kernel/mm/physical_allocator.h"
 #include "kernel/mm/unique_ptr.h"
 
@@ -33,21 +34,43 @@ namespace mm {
 
 class Memory {
  public:
-  Memory();
+  Memory(const MemoryMap& map);
 
   void Select(AddressSpace& space);
 
+  /**
+   * @brief Enable MMU of secondary core by the kernel space
+   */
+  void StartCore();
+
+  /**
+   * @brief Identity map range in the kernel space, nothing is done if
+   *        its first page is mapped
+   */
+  void MapDirect(void* begin, const size_t length, const MemoryType type);
+
+  /**
+   * @brief Handle abort in the selected address space
+   */
+  bool HandleFault(const arch::arm64::mm::Fault& fault);
+
   PagedRegion::Sptr CreatePagedRegion(const size_t count);
+  LazyRegion::Sptr CreateLazyRegion(const size_t count);
   DirectRegion::Sptr CreateDirectRegion(void* begin, const size_t length);
 
   AddressSpace::Uptr CreateAddressSpace();
 
  private:
-  void InitPagePool();
+  void InitZones();
   void InitPhSpace();
+  void CleanVcRam();
+
+  static Region::Attributes RangeAttributes(const MemoryType type);
 
+  MemoryMap map_;
   arch::mm::MMU mmu_;
   AddressSpace::Uptr p_space_;
+  AddressSpace* current_;
 };
 
 }  // namespace mm
@@ -0,0 +1,219 @@
+/*=============================================================================
+Project Z - Operating system for ARM processors
+Copyright (C) 2018 Vladyslav Samodelok <vladfux4@gmail.com>
+All rights reserved.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+=============================================================================*/
+#ifndef KERNEL_MM_MEMORY_MAP_H_
+#define KERNEL_MM_MEMORY_MAP_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "kernel/utils/fdt.h"
+
+namespace kernel {
+namespace mm {
+
+/**
+ * @brief The physical memory range type enum
+ */
+enum class MemoryType {
+  RAM,
+  VC_RAM,  // memory shared with VideoCore, mapped non-cacheable
+  DEVICE,
+};
+
+struct MemoryRange {
+  uintptr_t base;
+  size_t length;
+  MemoryType type;
+
+  uintptr_t End() const { return (base + length); }
+};
+
+/**
+ * @brief The physical memory map
+ *
+ * Fixed size table of physical ranges, filled once on boot.
+ */
+class MemoryMap {
+ public:
+  static constexpr size_t kMaxRanges = 16;
+
+  MemoryMap() : ranges_(), count_(0), dropped_(0) {}
+
+  bool Add(const MemoryRange& range) {
+    if ((count_ >= kMaxRanges) || (0 == range.length)) {
+      return false;
+    }
+
+    ranges_[count_++] = range;
+    return true;
+  }
+
+  /**
+   * @brief Find first range of type, nullptr if the map has no such range
+   */
+  const MemoryRange* Find(const MemoryType type) const {
+    for (auto& range : *this) {
+      if (type == range.type) {
+        return &range;
+      }
+    }
+
+    return nullptr;
+  }
+
+  /**
+   * @brief Find range of type which contains the address
+   */
+  const MemoryRange* Find(const MemoryType type, const uintptr_t address) const {
+    for (auto& range : *this) {
+      if ((type == range.type) && (address >= range.base) &&
+          (address < range.End())) {
+        return &range;
+      }
+    }
+
+    return nullptr;
+  }
+
+  /**
+   * @brief Cut reserved range out of RAM ranges
+   *
+   * @return false if a split tail did not fit the table and is dropped
+   */
+  bool Reserve(const uintptr_t base, const size_t length) {
+    bool fit = true;
+    const uintptr_t end = (base + length);
+    for (size_t i = 0; i < count_; ++i) {
+      MemoryRange& range = ranges_[i];
+      if ((MemoryType::RAM != range.type) || (end <= range.base) ||
+          (base >= range.End())) {
+        continue;
+      }
+
+      const uintptr_t range_end = range.End();
+      if ((base > range.base) && (end < range_end)) {
+        // split, tail goes to the end of the table
+        range.length = (base - range.base);
+        if (!Add({end, (range_end - end), MemoryType::RAM})) {
+          dropped_ += (range_end - end);
+          fit = false;
+        }
+      } else if (base > range.base) {
+        range.length = (base - range.base);
+      } else if (end < range_end) {
+        range.base = end;
+        range.length = (range_end - end);
+      } else {
+        Remove(i--);
+      }
+    }
+
+    return fit;
+  }
+
+  size_t Count() const { return count_; }
+
+  /**
+   * @brief Bytes of RAM lost because the table was full
+   */
+  size_t Dropped() const { return dropped_; }
+  const MemoryRange* begin() const { return &ranges_[0]; }
+  const MemoryRange* end() const { return &ranges_[count_]; }
+
+  /**
+   * @brief Raspberry Pi 3 layout with 1GB of memory split 880/128 for GPU
+   */
+  static MemoryMap Default() {
+    MemoryMap map;
+    map.Add({0, (880ULL << 20), MemoryType::RAM});
+    map.Add({(880ULL << 20), (128ULL << 20), MemoryType::VC_RAM});
+    // peripherals at 0x3F000000 - 0x40000000
+    map.Add({(1008ULL << 20), (16ULL << 20), MemoryType::DEVICE});
+    // mailboxes at 0x40000000
+    map.Add({(1024ULL << 20), (2ULL << 20), MemoryType::DEVICE});
+    return map;
+  }
+
+  /**
+   * @brief Board layout with RAM described by the device tree
+   *
+   * RAM ranges and reservations come from the blob and are clipped below
+   * the peripherals, VideoCore memory takes the gap up to the peripherals.
+   * Default layout is used if the blob is not valid or has no memory.
+   */
+  static MemoryMap FromFdt(const utils::Fdt& fdt) {
+    const MemoryMap board = Default();
+    if (!fdt.Valid()) {
+      return board;
+    }
+
+    uintptr_t device_begin = UINTPTR_MAX;
+    for (auto& range : board) {
+      if ((MemoryType::DEVICE == range.type) && (range.base < device_begin)) {
+        device_begin = range.base;
+      }
+    }
+
+    MemoryMap map;
+    uintptr_t ram_end = 0;
+    fdt.ForEachMemory([&](const uint64_t base, const uint64_t length) {
+      const uintptr_t end =
+          ((base + length) < device_begin) ? (base + length) : device_begin;
+      if ((base < end) && map.Add({base, (end - base), MemoryType::RAM})) {
+        ram_end = (end > ram_end) ? end : ram_end;
+      }
+    });
+
+    if (0 == map.Count()) {
+      return board;
+    }
+
+    fdt.ForEachReserved([&](const uint64_t base, const uint64_t length) {
+      map.Reserve(base, length);
+    });
+
+    for (auto& range : board) {
+      if (MemoryType::DEVICE == range.type) {
+        map.Add(range);
+      } else if ((MemoryType::VC_RAM == range.type) &&
+                 (ram_end < range.End())) {
+        const uintptr_t base = (ram_end > range.base) ? ram_end : range.base;
+        map.Add({base, (range.End() - base), MemoryType::VC_RAM});
+      }
+    }
+
+    return map;
+  }
+
+ private:
+  void Remove(const size_t index) {
+    for (size_t i = index; (i + 1) < count_; ++i) {
+      ranges_[i] = ranges_[i + 1];
+    }
+
+    count_--;
+  }
+
+  MemoryRange ranges_[kMaxRanges];
+  size_t count_;
+  size_t dropped_;
+};
+
+}  // namespace mm
+}  // namespace kernel
+
+#endif  // KERNEL_MM_MEMORY_MAP_H_
@@ -0,0 +1,124 @@
+/*=============================================================================
+Project Z - Operating system for ARM processors
+Copyright (C) 2018 Vladyslav Samodelok <vladfux4@gmail.com>
+All rights reserved.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+=============================================================================*/
+#ifndef KERNEL_MM_PAGE_MAGAZINE_H_
+#define KERNEL_MM_PAGE_MAGAZINE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace kernel {
+namespace mm {
+
+/**
+ * @brief The Page magazine class
+ *
+ * Small LIFO stack of free page indexes owned by a single core. Allocation
+ * and deallocation touch only the stack, the backing pool is locked only
+ * to move a batch of indexes in or out.
+ */
+template <class Index, std::size_t kSize>
+class PageMagazine {
+ public:
+  static_assert(kSize >= 2, "Magazine should fit at least two batches");
+
+  static constexpr Index kNoIndex = static_cast<Index>(-1);
+  static constexpr std::size_t kBatch = (kSize / 2);
+
+  struct Statistics {
+    std::size_t hits;
+    std::size_t misses;
+    std::size_t refills;
+    std::size_t drains;
+  };
+
+  PageMagazine() : count_(0), stats_{0, 0, 0, 0} {}
+
+  template <class Pool, class Lock>
+  Index Allocate(Pool& pool, Lock& lock) {
+    if (0 == count_) {
+      stats_.misses++;
+
+      lock.Lock();
+      Refill(pool);
+      lock.Unlock();
+
+      if (0 == count_) {
+        return kNoIndex;
+      }
+    } else {
+      stats_.hits++;
+    }
+
+    return items_[--count_];
+  }
+
+  template <class Pool, class Lock>
+  void Deallocate(Pool& pool, Lock& lock, const Index index) {
+    if (kSize == count_) {
+      lock.Lock();
+      Drain(pool, kBatch);
+      lock.Unlock();
+    }
+
+    items_[count_++] = index;
+  }
+
+  /**
+   * @brief Return all cached indexes to the pool
+   */
+  template <class Pool, class Lock>
+  void Flush(Pool& pool, Lock& lock) {
+    lock.Lock();
+    Drain(pool, count_);
+    lock.Unlock();
+  }
+
+  std::size_t Count() const { return count_; }
+  const Statistics& Stats() const { return stats_; }
+
+ private:
+  template <class Pool>
+  void Refill(Pool& pool) {
+    stats_.refills++;
+    while (count_ < kBatch) {
+      auto index = pool.AllocateByIndex();
+      if (kNoIndex == index) {
+        break;
+      }
+
+      items_[count_++] = index;
+    }
+  }
+
+  template <class Pool>
+  void Drain(Pool& pool, std::size_t count) {
+    stats_.drains++;
+    while ((0 != count) && (0 != count_)) {
+      pool.DeallocateByIndex(items_[--count_]);
+      count--;
+    }
+  }
+
+  std::size_t count_;
+  Statistics stats_;
+  Index items_[kSize];
+};
+
+}  // namespace mm
+}  // namespace kernel
+
+#endif  // KERNEL_MM_PAGE_MAGAZINE_H_
@@ -20,69 +20,177 @@ GNU General Public License for more details.
 #include <cstddef>
 #include <cstdint>
 
+// Arch mutex is included directly, the generated arch types header
+// includes the MMU which depends back on the page pool
+#include "arch/arm64/cpu.h"
+#include "arch/arm64/mutex.h"
 #include "kernel/config.h"
+#include "kernel/hal/mutex_base.h"
+#include "kernel/mm/bitmap_pool.h"
 #include "kernel/mm/boot_allocator.h"
-#include "kernel/mm/pool.h"
-#include "kernel/utils/static_wrapper.h"
+#include "kernel/mm/buddy_pool.h"
+#include "kernel/mm/page_magazine.h"
 
 namespace kernel {
 namespace mm {
 
 struct __attribute__((__packed__)) PageInfo {
-  bool value;
+  uint8_t heap_class;  // owner size class of kernel heap, 0 if not heap page
+  uint8_t order;       // order of the heap page block
+  uint16_t cow_refs;   // spaces which map the page copy-on-write
 };
 
-class PagePool : public Pool<PageInfo, size_t, BootAllocator> {
+// Biggest page block is 2MB, so it can be mapped by one block descriptor
+constexpr uint8_t kPagePoolMaxOrder =
+    BlockOrder((1ULL << 21) / PageSizeInfo<KERNEL_PAGE_SIZE>::in_bytes);
+
+template <PageAllocatorType kType>
+struct PagePoolBackend {};
+
+template <>
+struct PagePoolBackend<PageAllocatorType::BUDDY> {
+  using Type = BuddyPool<PageInfo, uint32_t, kPagePoolMaxOrder, BootAllocator>;
+};
+
+template <>
+struct PagePoolBackend<PageAllocatorType::BITMAP> {
+  using Type = BitmapPool<PageInfo, uint32_t, BootAllocator>;
+};
+
+class PagePool : public PagePoolBackend<KERNEL_PAGE_ALLOCATOR>::Type {
  public:
+  using PoolType = PagePoolBackend<KERNEL_PAGE_ALLOCATOR>::Type;
+  using Index = uint32_t;
+  using Magazine = PageMagazine<Index, 32>;
+  using Lock = hal::MutexBase<arch::arm64::Mutex>;
+  using ReclaimHandler = size_t (*)();
+
+  static constexpr size_t kPageBytes = PageSizeInfo<KERNEL_PAGE_SIZE>::in_bytes;
+  static constexpr uint8_t kMaxOrder = kPagePoolMaxOrder;
+  static constexpr size_t kMaxBlockBytes = (kPageBytes << kMaxOrder);
+
   static constexpr size_t GetPageCount(const size_t bytes) {
-    return (bytes / PageSizeInfo<KERNEL_PAGE_SIZE>::in_bytes);
+    return (bytes / kPageBytes);
   }
 
-  void CutBytes(const size_t length) { Pool::Cut(GetPageCount(length)); }
+  void CutBytes(const size_t length) { Cut(GetPageCount(length)); }
 
   uint8_t* BeginAddress() { return begin_; }
   void SetBeginAddress(uint8_t* address) { begin_ = address; }
 
-  PagePool(const size_t length) : Pool(GetPageCount(length)), begin_(nullptr) {}
+  uint8_t* IndexToAddress(const Index index) {
+    return begin_ + (kPageBytes * index);
+  }
 
-  void LogInfo() {
-    LOG(DEBUG) << "Free: " << FreeSlots();
-    LOG(DEBUG) << "Used pages: " << (Size() - FreeSlots());
+  Index AddressToIndex(const void* address) {
+    return ((reinterpret_cast<const uint8_t*>(address) - begin_) / kPageBytes);
   }
 
-  uint8_t* begin_;
-};
+  PageInfo& Info(const void* address) { return At(AddressToIndex(address)); }
 
-using StaticPagePool = utils::StaticWrapper<PagePool>;
+  bool Contains(const void* address) const {
+    auto byte = reinterpret_cast<const uint8_t*>(address);
+    return ((byte >= begin_) && (byte < (begin_ + (kPageBytes * Size()))));
+  }
 
-template <typename T, size_t kAlignment = 0>
-struct PagePoolAllocator {
-  static_assert(sizeof(T) <= PageSizeInfo<KERNEL_PAGE_SIZE>::in_bytes);
+  PagePool(const size_t length)
+      : PoolType(GetPageCount(length)),
+        begin_(nullptr),
+        lock_(),
+        reclaim_handler_(nullptr) {}
+
+  /**
+   * @brief Set handler which releases cached pages under memory pressure
+   */
+  void SetReclaimHandler(ReclaimHandler handler) { reclaim_handler_ = handler; }
+
+  /**
+   * @brief Allocate single page from the magazine of the current core
+   *
+   * Magazine is used with IRQ masked, so neither a fault handler which
+   * allocates nor a migration to another core interleaves with it.
+   */
+  Index AllocatePage() {
+    Index index = kNoIndex;
+    {
+      hal::IrqGuard<Lock> guard;
+      index = LocalMagazine().Allocate(Backend(), lock_);
+    }
+
+    if ((kNoIndex == index) && (0 != Reclaim())) {
+      hal::IrqGuard<Lock> guard;
+      index = LocalMagazine().Allocate(Backend(), lock_);
+    }
+
+    return index;
+  }
 
-  static T* Allocate() {
-    auto& pool = StaticPagePool::Value();
-    auto info = pool.Allocate();
-    auto index = pool.ToIndex(info);
-    uint8_t* address = pool.BeginAddress() +
-                       (PageSizeInfo<KERNEL_PAGE_SIZE>::in_bytes * index);
+  void DeallocatePage(const Index index) {
+    hal::IrqGuard<Lock> guard;
+    LocalMagazine().Deallocate(Backend(), lock_, index);
+  }
 
-    LOG(VERBOSE) << "Alloc index: " << index
-                 << " address:" << address;
-    return reinterpret_cast<T*>(address);
+  /**
+   * @brief Allocate block of 2^order pages directly from the backend pool
+   */
+  Index AllocateBlock(const uint8_t order) {
+    auto index = LockedAllocate(order);
+    if (kNoIndex == index) {
+      // empty slabs and cached single pages can block the buddy merge
+      Reclaim();
+      {
+        hal::IrqGuard<Lock> guard;
+        LocalMagazine().Flush(Backend(), lock_);
+      }
+      index = LockedAllocate(order);
+    }
+
+    return index;
   }
 
-  static void Deallocate(T* address) {
-    auto& pool = StaticPagePool::Value();
-    auto index = ((reinterpret_cast<uint8_t*>(address) - pool.BeginAddress()) /
-                  PageSizeInfo<KERNEL_PAGE_SIZE>::in_bytes);
+  void DeallocateBlock(const Index index, const uint8_t order) {
+    hal::IrqSaveGuard<Lock> guard(lock_);
+    DeallocateByIndex(index, order);
+  }
+
+  void LogInfo() {
+    LOG(DEBUG) << "Free: " << FreeSlots();
+    LOG(DEBUG) << "Used pages: " << (Size() - FreeSlots());
+    for (uint8_t order = 0; order <= kMaxOrder; ++order) {
+      LOG(DEBUG) << "Free blocks of order " << order << ": "
+                 << FreeBlocks(order);
+    }
+
+    for (size_t core = 0; core < KERNEL_CPU_COUNT; ++core) {
+      const auto& stats = magazines_[core].Stats();
+      LOG(DEBUG) << "Core " << core << " cached: " << magazines_[core].Count()
+                 << " hits: " << stats.hits << " misses: " << stats.misses
+                 << " refills: " << stats.refills
+                 << " drains: " << stats.drains;
+    }
+  }
 
-    address->~T();
-    LOG(VERBOSE) << "Dealloc index: " << index
-                 << " address:" << address;
-    pool.DeallocateByIndex(index);
+  /**
+   * @brief Run the reclaim handler, returns number of released pages
+   */
+  size_t Reclaim() {
+    return (nullptr != reclaim_handler_) ? reclaim_handler_() : 0;
   }
 
+  uint8_t* begin_;
+
  private:
+  Magazine& LocalMagazine() { return magazines_[arch::arm64::Cpu::CoreId()]; }
+  PoolType& Backend() { return *this; }
+
+  Index LockedAllocate(const uint8_t order) {
+    hal::IrqSaveGuard<Lock> guard(lock_);
+    return AllocateByIndex(order);
+  }
+
+  Lock lock_;
+  ReclaimHandler reclaim_handler_;
+  Magazine magazines_[KERNEL_CPU_COUNT];
 };
 
 }  // namespace mm
@@ -19,95 +19,236 @@ GNU General Public License for more details.
 
 #include <cstddef>
 #include <cstdint>
+#include <new>
 
-#include "kernel/mm/page_pool.h"
+#include "kernel/mm/zone.h"
+#include "kernel/mm/pool.h"
 #include "kernel/mm/boot_allocator.h"
 
 namespace kernel {
 namespace mm {
 
+/**
+ * @brief Slab cache configuration, can be specialized per type
+ */
+template <typename T>
+struct SlabConfig {
+  // Empty slabs kept for reuse before their pages go back to the page pool
+  static constexpr size_t kEmptySlabLimit = 2;
+};
+
 struct PageSlabAllocatorBase {
  public:
+  /**
+   * @brief Per type slab statistics
+   */
+  struct Statistics {
+    size_t object_size;
+    size_t slab_capacity;
+    size_t slabs;
+    size_t objects;
+    size_t (*reclaim)();
+    bool registered;
+    Statistics* next;
+
+    size_t WastedBytes() const {
+      return (slabs * PageSizeInfo<KERNEL_PAGE_SIZE>::in_bytes) -
+             (objects * object_size);
+    }
+  };
+
   static inline size_t used_objects = 0;
 
   static void LogInfo() {
     LOG(DEBUG) << "Used objects: " << used_objects;
+    for (auto stats = statistics_; stats != nullptr; stats = stats->next) {
+      LOG(DEBUG) << "Slab object size: " << stats->object_size
+                 << " capacity: " << stats->slab_capacity
+                 << " slabs: " << stats->slabs
+                 << " objects: " << stats->objects
+                 << " wasted bytes: " << stats->WastedBytes();
+    }
+  }
+
+  /**
+   * @brief Return empty slabs of all types to the page pool
+   *
+   * @return number of released pages
+   */
+  static size_t Reclaim() {
+    size_t pages = 0;
+    for (auto stats = statistics_; stats != nullptr; stats = stats->next) {
+      pages += stats->reclaim();
+    }
+
+    return pages;
+  }
+
+ protected:
+  static void Register(Statistics& stats) {
+    if (!stats.registered) {
+      stats.registered = true;
+      stats.next = statistics_;
+      statistics_ = &stats;
+    }
   }
+
+ private:
+  static inline Statistics* statistics_ = nullptr;
 };
 
-template <typename T, size_t kAlignment>
+/**
+ * @brief The Page slab allocator
+ *
+ * Each slab is one page aligned Node, so the owner of an object is found
+ * by masking its address. Slabs are kept in partial, full and empty lists,
+ * both allocation and deallocation take constant time.
+ */
+template <typename T, size_t kAlignment,
+          template <class, size_t> class PageAllocatorBase = PagePoolAllocator>
 struct PageSlabAllocator : public PageSlabAllocatorBase {
  public:
   struct Node {
     using Index = std::size_t;
     static constexpr Index kPageSize = PageSizeInfo<KERNEL_PAGE_SIZE>::in_bytes;
-    static constexpr Index kPoolBufferSize = (kPageSize - sizeof (Node*));
+    static constexpr Index kPoolBufferSize = (kPageSize - (2 * sizeof (Node*)));
     static constexpr Index kPoolSize = StaticPoolSize<Index, T>::ForBuffer(kPoolBufferSize);
 
-    Node() : next(nullptr), pool() {}
+    Node() : next(nullptr), prev(nullptr), pool() {}
 
     Node* next;
+    Node* prev;
     StaticPool<T, kPoolSize, Index> pool;
   };
   static_assert (sizeof (Node) <= Node::kPageSize);
 
-  static T* Allocate() {
-    if (!root_) {
-      root_ = new (PagePoolAllocator<Node>::Allocate()) Node();
-      LOG(VERBOSE) << "Alloc root: " << root_ << " type size: " << sizeof (T);
+  using PageAllocator = PageAllocatorBase<Node, 0>;
+
+  struct NodeList {
+    void Push(Node* node) {
+      node->prev = nullptr;
+      node->next = head;
+      if (head != nullptr) {
+        head->prev = node;
+      }
+
+      head = node;
+      count++;
     }
 
-    Node* node = root_;
-    while (node != nullptr) {
-      if (0 != node->pool.FreeSlots()) {
-        used_objects++;
-        return node->pool.Allocate();
+    void Remove(Node* node) {
+      if (node->prev != nullptr) {
+        node->prev->next = node->next;
+      } else {
+        head = node->next;
       }
 
-      if (node->next == nullptr) {
-        node->next = new (PagePoolAllocator<Node>::Allocate()) Node();
-        node = node->next;
+      if (node->next != nullptr) {
+        node->next->prev = node->prev;
       }
+
+      node->next = nullptr;
+      node->prev = nullptr;
+      count--;
     }
 
-    return nullptr;
-  }
+    Node* head;
+    size_t count;
+  };
 
-  static void Deallocate(T* address) {
-    Node* prev = nullptr;
-    Node* node = root_;
-
-    while (node != nullptr) {
-      if (node->pool.IsRelated(address)) {
-        used_objects--;
-        node->pool.Deallocate(address);
-
-        if (node->pool.Empty()) {
-          if (prev != nullptr) {
-            prev->next = node->next;
-          } else {
-            root_ = node->next;
-          }
-
-          node->~Node();
-          PagePoolAllocator<Node>::Deallocate(node);
-        }
-
-        break;
+  static T* Allocate() {
+    Node* node = partial_.head;
+    if (node == nullptr) {
+      node = empty_.head;
+      if (node != nullptr) {
+        empty_.Remove(node);
       } else {
-        prev = node;
-        node = node->next;
+        node = new (PageAllocator::Allocate()) Node();
+        LOG(VERBOSE) << "Alloc slab: " << node << " type size: " << sizeof (T);
+
+        Register(stats_);
+        stats_.slabs++;
       }
+
+      partial_.Push(node);
     }
+
+    T* item = node->pool.Allocate();
+    if (0 == node->pool.FreeSlots()) {
+      partial_.Remove(node);
+      full_.Push(node);
+    }
+
+    used_objects++;
+    stats_.objects++;
+    return item;
+  }
+
+  static void Deallocate(T* address) {
+    Node* node = NodeOf(address);
+    const bool was_full = (0 == node->pool.FreeSlots());
+
+    used_objects--;
+    stats_.objects--;
+    node->pool.Deallocate(address);
+
+    if (node->pool.Empty()) {
+      (was_full ? full_ : partial_).Remove(node);
+      Release(node);
+    } else if (was_full) {
+      full_.Remove(node);
+      partial_.Push(node);
+    }
+  }
+
+  static const Statistics& Stats() { return stats_; }
+
+  /**
+   * @brief Return empty slabs of the type to the page pool
+   *
+   * @return number of released pages
+   */
+  static size_t Reclaim() {
+    size_t pages = 0;
+    while (empty_.head != nullptr) {
+      Node* node = empty_.head;
+      empty_.Remove(node);
+      Free(node);
+      pages++;
+    }
+
+    return pages;
+  }
+
+  static Node* NodeOf(const T* address) {
+    return reinterpret_cast<Node*>(reinterpret_cast<uintptr_t>(address) &
+                                   ~(Node::kPageSize - 1));
   }
 
  private:
-  static Node* root_;
-};
+  static void Release(Node* node) {
+    // keep some empty slabs, so alloc/free on a slab border does not
+    // bounce the page to the page pool
+    if (empty_.count < SlabConfig<T>::kEmptySlabLimit) {
+      empty_.Push(node);
+      return;
+    }
+
+    Free(node);
+  }
+
+  static void Free(Node* node) {
+    stats_.slabs--;
+    node->~Node();
+    PageAllocator::Deallocate(node);
+  }
 
-template <typename T, size_t kAlignment>
-typename PageSlabAllocator<T, kAlignment>::Node*
-PageSlabAllocator<T, kAlignment>::root_ = nullptr;
+  static inline Statistics stats_ = {sizeof(T), Node::kPoolSize, 0, 0,
+                                     &Reclaim, false, nullptr};
+  static inline NodeList partial_ = {nullptr, 0};
+  static inline NodeList full_ = {nullptr, 0};
+  static inline NodeList empty_ = {nullptr, 0};
+};
 
 template <typename T, typename Spec = void>
 struct AllocatorSelector {
@@ -129,6 +270,14 @@ struct AllocatorSelector<
   using Type = PagePoolAllocator<ValueType, kValueAlignment>;
 };
 
+template <typename T>
+struct AllocatorSelector<
+    T,
+    std::enable_if_t<(sizeof(T) > PageSizeInfo<KERNEL_PAGE_SIZE>::in_bytes)>> {
+  template <typename ValueType, size_t kValueAlignment>
+  using Type = PageBlockAllocator<ValueType, kValueAlignment>;
+};
+
 template <typename T, size_t kAlignment = 0>
 struct SlabAllocator : AllocatorSelector<T>::template Type<T, kAlignment> {
   template <typename... Args>
@@ -30,21 +30,32 @@ class IndexPool {
     Index next;
   };
 
+  /**
+   * @brief Constructor
+   *
+   * Indexes above the watermark were never allocated and are handed out
+   * without touching the index list, so the construction does not depend
+   * on the pool size.
+   */
   IndexPool(IndexData* index_list, Index size)
-      : size_(size), head_(0), free_items_(size), index_list_(index_list) {
-    for (Index i = 0; i < size_; ++i) {
-      index_list_[i].next = (i + 1);
-    }
-  }
+      : size_(size),
+        head_(kNoIndex),
+        free_items_(size),
+        watermark_(0),
+        index_list_(index_list) {}
 
   ~IndexPool() {}
 
   Index Allocate() {
     Index ret_val = kNoIndex;
     if (0 != free_items_) {
-      ret_val = head_;
       free_items_--;
-      head_ = index_list_[head_].next;
+      if (kNoIndex != head_) {
+        ret_val = head_;
+        head_ = index_list_[head_].next;
+      } else {
+        ret_val = watermark_++;
+      }
     }
 
     return ret_val;
@@ -60,6 +71,8 @@ class IndexPool {
     if ((size < size_) && (free_items_ == size_)) {
       size_ = size;
       free_items_ = size;
+      head_ = kNoIndex;
+      watermark_ = 0;
     }
   }
 
@@ -74,6 +87,7 @@ class IndexPool {
   Index size_;
   Index head_;
   Index free_items_;
+  Index watermark_;
   IndexData* index_list_;
 };
 
@@ -139,7 +153,7 @@ struct StaticPoolSize {
   }
 };
 
-static_assert (StaticPoolSize<std::size_t, std::size_t>::ForBuffer(4096) == 254);
+static_assert (StaticPoolSize<std::size_t, std::size_t>::ForBuffer(4096) == 253);
 static_assert (sizeof(IndexPool<std::size_t>) + sizeof(std::size_t) + sizeof(std::size_t)
                == sizeof(StaticPool<std::size_t, 1, std::size_t>));
 static_assert (sizeof(IndexPool<std::size_t>) + (sizeof(std::size_t) + sizeof(std::size_t))*2
@@ -57,31 +57,144 @@ class DirectRegion : public Region {
 class PagedRegion : public Region {
  public:
   using Page = kernel::mm::Page<KERNEL_PAGE_SIZE>;
-  using PageContainer = utils::List<Page*, SlabAllocator>;
+  using PageAllocator = PagePoolAllocator<Page>;
   using Sptr = SharedPointer<PagedRegion, SlabAllocator>;
 
+  /**
+   * @brief Physically contiguous block of 2^order pages
+   */
+  struct Block {
+    Page* begin;
+    uint8_t order;
+
+    std::size_t Count() const { return (static_cast<std::size_t>(1) << order); }
+  };
+
+  using BlockContainer = utils::List<Block, SlabAllocator>;
+
   PagedRegion(std::size_t count)
-    : Region(count * PageSizeInfo<KERNEL_PAGE_SIZE>::in_bytes), pages_() {
-    for (size_t i = 0; i < count; i++) {
-      auto page = SlabAllocator<Page>::Allocate();
-      LOG(VERBOSE) << "Add page to region: " << page;
-      pages_.Push(page);
+    : Region(count * PageSizeInfo<KERNEL_PAGE_SIZE>::in_bytes), blocks_(),
+      written_(false) {
+    std::size_t left = count;
+    while (left != 0) {
+      // take the biggest block first, fall back to smaller on fragmentation
+      uint8_t order = FloorBlockOrder(left);
+      if (order > PagePool::kMaxOrder) {
+        order = PagePool::kMaxOrder;
+      }
+
+      Page* page = PageAllocator::Allocate(order);
+      while ((nullptr == page) && (0 != order)) {
+        order--;
+        page = PageAllocator::Allocate(order);
+      }
+
+      if (nullptr == page) {
+        LOG(ERROR) << "Failed to allocate region pages, left: " << left;
+        break;
+      }
+
+      LOG(VERBOSE) << "Add block to region: " << page << " order: " << order;
+      blocks_.Push({page, order});
+      left -= (static_cast<std::size_t>(1) << order);
     }
   }
 
   ~PagedRegion() {
     LOG(DEBUG) << "~PagedRegion";
 
-    for (auto it = pages_.Begin(); it != pages_.End(); it++) {
-      SlabAllocator<Page>::Deallocate(it.Value());
-      LOG(VERBOSE) << "Remove page from region: " << it.Value();
+    for (auto it = blocks_.Begin(); it != blocks_.End(); it++) {
+      PageAllocator::Deallocate(it.Value().begin, it.Value().order);
+      LOG(VERBOSE) << "Remove block from region: " << it.Value().begin;
+    }
+  }
+
+  BlockContainer& Blocks() { return blocks_; }
+
+  /**
+   * @brief Get page by index in the region
+   */
+  Page* PageAt(std::size_t index) {
+    for (auto it = blocks_.Begin(); it != blocks_.End(); it++) {
+      if (index < it.Value().Count()) {
+        return (it.Value().begin + index);
+      }
+      index -= it.Value().Count();
+    }
+
+    return nullptr;
+  }
+
+  /**
+   * @brief Mark that the last copy-on-write sharer took a page for writing,
+   *        so the region can not be shared again
+   */
+  void MarkWritten() { written_ = true; }
+  bool Written() const { return written_; }
+
+ private:
+  BlockContainer blocks_;
+  bool written_;
+};
+
+/**
+ * @brief Region which pages are allocated on the first touch
+ *
+ * Nothing is mapped up front, translation faults in the region are
+ * backed by zeroed pages. Page is shared by all spaces which map
+ * the region.
+ */
+class LazyRegion : public Region {
+ public:
+  using Page = kernel::mm::Page<KERNEL_PAGE_SIZE>;
+  using PageAllocator = PagePoolAllocator<Page>;
+  using Sptr = SharedPointer<LazyRegion, SlabAllocator>;
+
+  struct Slot {
+    std::size_t index;
+    Page* page;
+  };
+
+  using SlotContainer = utils::List<Slot, SlabAllocator>;
+
+  LazyRegion(std::size_t count)
+    : Region(count * PageSizeInfo<KERNEL_PAGE_SIZE>::in_bytes), slots_() {
+  }
+
+  ~LazyRegion() {
+    LOG(DEBUG) << "~LazyRegion touched: " << slots_.size();
+
+    for (auto it = slots_.Begin(); it != slots_.End(); it++) {
+      PageAllocator::Deallocate(it.Value().page, 0);
+    }
+  }
+
+  /**
+   * @brief Get page by index, allocate zeroed one on the first touch
+   */
+  Page* Touch(const std::size_t index) {
+    for (auto it = slots_.Begin(); it != slots_.End(); it++) {
+      if (it.Value().index == index) {
+        return it.Value().page;
+      }
     }
+
+    Page* page = PageAllocator::Allocate(0);
+    if (nullptr == page) {
+      LOG(ERROR) << "Failed to allocate lazy region page: " << index;
+      return nullptr;
+    }
+
+    memset(page, 0, sizeof(Page));
+    slots_.Push({index, page});
+    LOG(VERBOSE) << "Touch lazy region page: " << index << " -> " << page;
+    return page;
   }
 
-  PageContainer& Pages() { return pages_; }
+  std::size_t Touched() const { return slots_.size(); }
 
  private:
-  PageContainer pages_;
+  SlotContainer slots_;
 };
 
 }  // namespace mm
@@ -0,0 +1,286 @@
+/*=============================================================================
+Project Z - Operating system for ARM processors
+Copyright (C) 2018 Vladyslav Samodelok <vladfux4@gmail.com>
+All rights reserved.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+=============================================================================*/
+#ifndef KERNEL_MM_ZONE_H_
+#define KERNEL_MM_ZONE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "kernel/config.h"
+#include "kernel/logger.h"
+#include "kernel/mm/page_pool.h"
+#include "kernel/utils/static_wrapper.h"
+
+namespace kernel {
+namespace mm {
+
+/**
+ * @brief The memory zone enum
+ */
+enum class ZoneType {
+  DMA,            // low memory reachable by DMA masters
+  NORMAL,         // cacheable memory for kernel objects
+  NON_CACHEABLE,  // VideoCore shared memory, coherent without maintenance
+};
+
+constexpr size_t kZoneCount = 3;
+
+struct Watermarks {
+  size_t min;  // pages kept for the zone owners, fallback can not take them
+  size_t low;  // cached pages are reclaimed when free pages drop below
+
+  static constexpr Watermarks ForPages(const size_t pages) {
+    return {(pages / 64), (pages / 32)};
+  }
+};
+
+/**
+ * @brief The memory zones
+ *
+ * Zone is made of page pools, one for each piece of RAM in the zone.
+ * Allocation starts from the requested zone and falls back to the next
+ * zone of its fallback list while that pool stays above its min watermark.
+ */
+class Zones {
+ public:
+  using Index = PagePool::Index;
+
+  // every memory map range may be split at the DMA limit
+  static constexpr size_t kMaxPools = 32;
+
+  Zones() : pools_(), count_(0) {}
+
+  /**
+   * @brief Add pool to zone
+   *
+   * @return false if the pool table is full
+   */
+  bool Add(const ZoneType type, PagePool& pool, const Watermarks& watermarks) {
+    if (count_ >= kMaxPools) {
+      LOG(ERROR) << "Zone pool is dropped, pages: " << pool.Size();
+      return false;
+    }
+
+    pools_[count_++] = {type, &pool, watermarks, false};
+    return true;
+  }
+
+  bool Present(const ZoneType type) const {
+    for (size_t i = 0; i < count_; ++i) {
+      if (type == pools_[i].type) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  /**
+   * @brief Find pool which owns the address, nullptr if none
+   */
+  PagePool* Owner(const void* address) {
+    for (size_t i = 0; i < count_; ++i) {
+      if (pools_[i].pool->Contains(address)) {
+        return pools_[i].pool;
+      }
+    }
+
+    return nullptr;
+  }
+
+  /**
+   * @brief Allocate block of 2^order pages from zone or its fallback zones
+   */
+  uint8_t* Allocate(const ZoneType type, const uint8_t order) {
+    const Fallback& fallback = kFallback[Id(type)];
+
+    for (size_t i = 0; i < fallback.count; ++i) {
+      for (size_t j = 0; j < count_; ++j) {
+        if (fallback.zones[i] != pools_[j].type) {
+          continue;
+        }
+
+        uint8_t* address = Allocate(pools_[j], order, (0 == i));
+        if (nullptr != address) {
+          return address;
+        }
+      }
+    }
+
+    return nullptr;
+  }
+
+  void Deallocate(void* address, const uint8_t order) {
+    PagePool* pool = Owner(address);
+    if (nullptr == pool) {
+      LOG(ERROR) << "Free of not zone memory: " << address;
+      return;
+    }
+
+    auto index = pool->AddressToIndex(address);
+    if (0 == order) {
+      pool->DeallocatePage(index);
+    } else {
+      pool->DeallocateBlock(index, order);
+    }
+  }
+
+  void LogInfo() {
+    for (size_t i = 0; i < count_; ++i) {
+      auto& entry = pools_[i];
+      LOG(DEBUG) << "Zone " << Id(entry.type)
+                 << " begin: " << entry.pool->BeginAddress()
+                 << " pages: " << entry.pool->Size()
+                 << " min: " << entry.watermarks.min
+                 << " low: " << entry.watermarks.low;
+      entry.pool->LogInfo();
+    }
+  }
+
+ private:
+  struct Fallback {
+    size_t count;
+    ZoneType zones[kZoneCount];
+  };
+
+  struct Entry {
+    ZoneType type;
+    PagePool* pool;
+    Watermarks watermarks;
+    bool reclaimed;  // pool was reclaimed since it dropped below low
+  };
+
+  // DMA and non-cacheable memory can not be replaced by other zones, normal
+  // allocations may take DMA memory above its reserve
+  static constexpr Fallback kFallback[kZoneCount] = {
+      {1, {ZoneType::DMA}},
+      {2, {ZoneType::NORMAL, ZoneType::DMA}},
+      {1, {ZoneType::NON_CACHEABLE}},
+  };
+
+  static constexpr size_t Id(const ZoneType type) {
+    return static_cast<size_t>(type);
+  }
+
+  static uint8_t* Allocate(Entry& entry, const uint8_t order,
+                           const bool preferred) {
+    PagePool* pool = entry.pool;
+    const size_t pages = (1ULL << order);
+
+    // reclaimed once per drop below low, the pool reclaims again only
+    // when an allocation fails
+    const bool low = (pool->FreeSlots() < entry.watermarks.low);
+    if (low && !entry.reclaimed) {
+      pool->Reclaim();
+    }
+    entry.reclaimed = low;
+
+    if (!preferred && (pool->FreeSlots() < (entry.watermarks.min + pages))) {
+      return nullptr;
+    }
+
+    auto index =
+        (0 == order) ? pool->AllocatePage() : pool->AllocateBlock(order);
+    return (PagePool::kNoIndex != index) ? pool->IndexToAddress(index)
+                                         : nullptr;
+  }
+
+  Entry pools_[kMaxPools];
+  size_t count_;
+};
+
+using StaticZones = utils::StaticWrapper<Zones>;
+
+template <typename T, size_t kAlignment = 0>
+struct PagePoolAllocator {
+  static_assert(sizeof(T) <= PageSizeInfo<KERNEL_PAGE_SIZE>::in_bytes);
+
+  static T* Allocate() { return Allocate(0); }
+
+  /**
+   * @brief Allocate physically contiguous block of 2^order normal pages
+   */
+  static T* Allocate(const uint8_t order) {
+    uint8_t* address = StaticZones::Value().Allocate(ZoneType::NORMAL, order);
+    if (nullptr == address) {
+      LOG(ERROR) << "Out of pages, order: " << order;
+      return nullptr;
+    }
+
+    LOG(VERBOSE) << "Alloc order: " << order << " address:" << address;
+    return reinterpret_cast<T*>(address);
+  }
+
+  static void Deallocate(T* address) {
+    address->~T();
+    Deallocate(address, 0);
+  }
+
+  static void Deallocate(T* address, const uint8_t order) {
+    LOG(VERBOSE) << "Dealloc order: " << order << " address:" << address;
+    StaticZones::Value().Deallocate(address, order);
+  }
+};
+
+/**
+ * @brief Allocator of types bigger than page, backed by a page block
+ */
+template <typename T, size_t kAlignment = 0>
+struct PageBlockAllocator {
+  using Page = kernel::mm::Page<KERNEL_PAGE_SIZE>;
+  static constexpr uint8_t kOrder = BlockOrder(
+      (sizeof(T) + PagePool::kPageBytes - 1) / PagePool::kPageBytes);
+  static_assert(kOrder <= PagePool::kMaxOrder, "Type does not fit page block");
+
+  static T* Allocate() {
+    return reinterpret_cast<T*>(PagePoolAllocator<Page>::Allocate(kOrder));
+  }
+
+  static void Deallocate(T* address) {
+    PagePoolAllocator<Page>::Deallocate(reinterpret_cast<Page*>(address),
+                                        kOrder);
+  }
+};
+
+/**
+ * @brief Normal pages and their info, page source of the heap and
+ *        copy-on-write pages
+ */
+struct ZonePages {
+  using Page = kernel::mm::Page<KERNEL_PAGE_SIZE>;
+
+  static void* Allocate(const uint8_t order) {
+    return PagePoolAllocator<Page>::Allocate(order);
+  }
+
+  static void Deallocate(void* ptr, const uint8_t order) {
+    PagePoolAllocator<Page>::Deallocate(reinterpret_cast<Page*>(ptr), order);
+  }
+
+  /**
+   * @brief Get info of the page which holds the address, nullptr if none
+   */
+  static PageInfo* Info(const void* ptr) {
+    auto pool = StaticZones::Value().Owner(ptr);
+    return (nullptr != pool) ? &pool->Info(ptr) : nullptr;
+  }
+};
+
+}  // namespace mm
+}  // namespace kernel
+
+#endif  // KERNEL_MM_ZONE_H_
@@ -0,0 +1,163 @@
+/*=============================================================================
+Project Z - Operating system for ARM processors
+Copyright (C) 2018 Vladyslav Samodelok <vladfux4@gmail.com>
+All rights reserved.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+=============================================================================*/
+#ifndef KERNEL_SCHEDULER_DISPATCHER_H_
+#define KERNEL_SCHEDULER_DISPATCHER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "kernel/logger.h"
+#include "kernel/scheduler/priority.h"
+#include "kernel/scheduler/run_queue.h"
+
+namespace kernel {
+namespace scheduler {
+
+/**
+ * @brief The choice of the running task of every core
+ *
+ * Higher level preempts the running task on wake and on tick, the slice
+ * of an expired task rotates within its level. Core is given by the
+ * caller, so the policy does not depend on the core it runs on.
+ */
+template <class Task, class Lock, size_t kCores, size_t kLevels>
+class Dispatcher {
+ public:
+  using Queues = RunQueues<Task, Lock, kCores, kLevels>;
+
+  /**
+   * @brief Make new task ready on the least loaded core
+   *
+   * @return core of the task
+   */
+  size_t Add(Task& task) { return queues_.Add(task); }
+
+  /**
+   * @brief Make task ready on the core it ran last
+   *
+   * @return true if the core differs from self and has to be signalled
+   */
+  bool Wake(Task& task, const size_t self) {
+    if (queues_.Wake(task, self)) {
+      return true;
+    }
+
+    // switch happens on return from the exception which woke the task
+    Task* running = slots_[task.core].next;
+    if ((running != nullptr) && (task.priority < running->priority)) {
+      Preempt(task.core, *running);
+    }
+
+    return false;
+  }
+
+  void Tick(const size_t core) {
+    auto& slot = slots_[core];
+    Task* running = slot.next;
+    if (running == nullptr) {
+      Switch(core);
+      return;
+    }
+
+    // real-time slice of 0 never expires
+    if (slot.left > 0) {
+      slot.left--;
+    }
+
+    const size_t top = queues_[core].Top();
+    if (top < running->priority) {
+      Preempt(core, *running);
+    } else if ((slot.left == 0) && (TimeSlice(running->priority) != 0) &&
+               (top == running->priority)) {
+      queues_[core].Push(*running);
+      Switch(core);
+    } else {
+      // nothing of the same level waits, expired slice is renewed
+      if (slot.left == 0) {
+        slot.left = TimeSlice(running->priority);
+      }
+
+      Select(core, *running);
+    }
+  }
+
+  void Select(const size_t core, Task& task) {
+    auto& slot = slots_[core];
+    if (slot.next != &task) {
+      slot.left = TimeSlice(task.priority);
+    }
+
+    slot.current = slot.next;
+    slot.next = &task;
+
+    LOG(INFO) << "Switch: "
+              << ((slot.current) ? slot.current->Name() : "Null")
+              << " ->" << ((slot.next) ? slot.next->Name() : "Null");
+  }
+
+  Task* Current(const size_t core) { return slots_[core].current; }
+  Task* Next(const size_t core) { return slots_[core].next; }
+
+  /**
+   * @brief Ticks left of the slice of the next task
+   */
+  size_t Left(const size_t core) { return slots_[core].left; }
+
+  bool Enabled(const size_t core) { return slots_[core].enabled; }
+  void SetEnabled(const size_t core, const bool enabled) {
+    slots_[core].enabled = enabled;
+  }
+
+ private:
+  /**
+   * @brief Tasks of one core, only the core itself accesses them
+   */
+  struct alignas(64) Slot {
+    Task* current = nullptr;
+    Task* next = nullptr;
+    size_t left = 0;  // ticks left of the slice of next
+    bool enabled = false;
+  };
+
+  /**
+   * @brief Put running task back at the head of its level and switch
+   *        to the higher one, it is the first of its level to run again
+   */
+  void Preempt(const size_t core, Task& running) {
+    LOG(DEBUG) << "Preempt: " << running.Name();
+    queues_[core].PushFront(running);
+    Switch(core);
+  }
+
+  /**
+   * @brief Select next task of the core, stolen one included
+   */
+  void Switch(const size_t core) {
+    Task* task = queues_.Next(core);
+    if (task != nullptr) {
+      Select(core, *task);
+    }
+  }
+
+  Queues queues_;
+  Slot slots_[kCores];
+};
+
+}  // namespace scheduler
+}  // namespace kernel
+
+#endif  // KERNEL_SCHEDULER_DISPATCHER_H_
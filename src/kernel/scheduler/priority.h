@@ -0,0 +1,66 @@
+/*=============================================================================
+Project Z - Operating system for ARM processors
+Copyright (C) 2018 Vladyslav Samodelok <vladfux4@gmail.com>
+All rights reserved.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+=============================================================================*/
+#ifndef KERNEL_SCHEDULER_PRIORITY_H_
+#define KERNEL_SCHEDULER_PRIORITY_H_
+
+#include <cstddef>
+
+#include "kernel/config.h"
+
+namespace kernel {
+namespace scheduler {
+
+static_assert(KERNEL_PRIORITY_LEVELS <= 64, "Levels must fit the bitmap");
+static_assert(KERNEL_RT_PRIORITY_LEVELS < KERNEL_PRIORITY_LEVELS,
+              "At least one normal level is required");
+static_assert(KERNEL_DEFAULT_PRIORITY < KERNEL_PRIORITY_LEVELS,
+              "Default priority is out of range");
+static_assert(KERNEL_TIME_SLICE_MIN <= KERNEL_TIME_SLICE_MAX,
+              "Higher normal level must not get shorter slice");
+
+/**
+ * @brief Check if priority is a real-time one
+ */
+constexpr bool IsRealTime(const size_t priority) {
+  return (priority < KERNEL_RT_PRIORITY_LEVELS);
+}
+
+/**
+ * @brief Get time slice of priority level
+ *
+ * @return ticks, 0 if the task is not sliced
+ */
+constexpr size_t TimeSlice(const size_t priority) {
+  constexpr size_t kNormal = (KERNEL_PRIORITY_LEVELS -
+                              KERNEL_RT_PRIORITY_LEVELS - 1);
+  if (IsRealTime(priority)) {
+    return KERNEL_RT_TIME_SLICE;
+  }
+
+  if (kNormal == 0) {
+    return KERNEL_TIME_SLICE_MAX;
+  }
+
+  const size_t level = (priority - KERNEL_RT_PRIORITY_LEVELS);
+  return (KERNEL_TIME_SLICE_MAX -
+          ((KERNEL_TIME_SLICE_MAX - KERNEL_TIME_SLICE_MIN) * level / kNormal));
+}
+
+}  // namespace scheduler
+}  // namespace kernel
+
+#endif  // KERNEL_SCHEDULER_PRIORITY_H_
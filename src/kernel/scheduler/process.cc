@@ -38,7 +38,9 @@ Process::Process(mm::UniquePointer<mm::AddressSpace,
   context_.registers.x0 = reinterpret_cast<uint64_t>(this);
   context_.elr = reinterpret_cast<void*>(ProcessBootstrap);
   context_.sp = sp;
-//  context_.translation_table = space_->translation_table.GetBase();
+  // both values are refreshed on every switch, ASID can change
+  context_.translation_table = space_->HigherTtbr();
+  context_.lower_translation_table = space_->LowerTtbr();
 
   LOG(DEBUG) << "SP: " << context_.sp;
   LOG(DEBUG) << "SPSR: " << context_.spsr.value;
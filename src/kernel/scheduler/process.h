@@ -59,6 +59,9 @@ class Process {
 
  public:
   Context context_;
+  Process* next = nullptr;  // link of the run queue
+  size_t core = 0;          // core of the run queue
+  size_t priority = KERNEL_DEFAULT_PRIORITY;  // 0 is the highest
 };
 
 }  // namespace scheduler
@@ -0,0 +1,223 @@
+/*=============================================================================
+Project Z - Operating system for ARM processors
+Copyright (C) 2018 Vladyslav Samodelok <vladfux4@gmail.com>
+All rights reserved.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+=============================================================================*/
+#ifndef KERNEL_SCHEDULER_RUN_QUEUE_H_
+#define KERNEL_SCHEDULER_RUN_QUEUE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "kernel/hal/mutex_base.h"
+
+namespace kernel {
+namespace scheduler {
+
+/**
+ * @brief The queue of tasks ready to run on one core
+ *
+ * Each priority level is a FIFO, bit (63 - level) of the bitmap marks a
+ * non-empty one, so the highest ready level is found with a single CLZ
+ * whatever the number of tasks. Task is linked through its own next
+ * field. The bitmap and the length are read without the lock to decide
+ * on preemption and to pick a victim.
+ */
+template <class Task, class Lock, size_t kLevels>
+class alignas(64) RunQueue {
+ public:
+  static_assert(kLevels <= 64, "Levels must fit the bitmap");
+
+  /**
+   * @brief Put task at the tail of its level
+   */
+  void Push(Task& task) {
+    hal::IrqSaveGuard<Lock> guard(lock_);
+    auto& level = levels_[task.priority];
+    task.next = nullptr;
+    if (level.tail == nullptr) {
+      level.head = &task;
+    } else {
+      level.tail->next = &task;
+    }
+
+    level.tail = &task;
+    Insert(task.priority);
+  }
+
+  /**
+   * @brief Put task at the head of its level, preempted task keeps its
+   *        turn
+   */
+  void PushFront(Task& task) {
+    hal::IrqSaveGuard<Lock> guard(lock_);
+    auto& level = levels_[task.priority];
+    task.next = level.head;
+    if (level.tail == nullptr) {
+      level.tail = &task;
+    }
+
+    level.head = &task;
+    Insert(task.priority);
+  }
+
+  /**
+   * @brief Take task which waited the longest on the highest level
+   *
+   * @return task or nullptr when the queue is empty
+   */
+  Task* Pop() {
+    hal::IrqSaveGuard<Lock> guard(lock_);
+    if (ready_ == 0) {
+      return nullptr;
+    }
+
+    const size_t priority = __builtin_clzll(ready_);
+    auto& level = levels_[priority];
+    Task* task = level.head;
+    level.head = task->next;
+    if (level.head == nullptr) {
+      level.tail = nullptr;
+      __atomic_store_n(&ready_, ready_ & ~Bit(priority), __ATOMIC_RELAXED);
+    }
+
+    task->next = nullptr;
+    __atomic_store_n(&count_, count_ - 1, __ATOMIC_RELAXED);
+    return task;
+  }
+
+  /**
+   * @brief Highest queued level, may be stale without the lock
+   *
+   * @return level or kLevels when the queue is empty
+   */
+  size_t Top() const {
+    const uint64_t ready = __atomic_load_n(&ready_, __ATOMIC_RELAXED);
+    return (ready == 0) ? kLevels : __builtin_clzll(ready);
+  }
+
+  /**
+   * @brief Number of queued tasks, may be stale without the lock
+   */
+  size_t Count() const { return __atomic_load_n(&count_, __ATOMIC_RELAXED); }
+
+ private:
+  struct Level {
+    Task* head = nullptr;
+    Task* tail = nullptr;
+  };
+
+  static constexpr uint64_t Bit(const size_t priority) {
+    return (1ULL << (63 - priority));
+  }
+
+  void Insert(const size_t priority) {
+    __atomic_store_n(&ready_, ready_ | Bit(priority), __ATOMIC_RELAXED);
+    __atomic_store_n(&count_, count_ + 1, __ATOMIC_RELAXED);
+  }
+
+  Lock lock_;
+  uint64_t ready_ = 0;
+  size_t count_ = 0;
+  Level levels_[kLevels];
+};
+
+/**
+ * @brief The Run queues of all cores
+ *
+ * Core takes work from its own queue only, the lock of another core is
+ * taken to wake a task there or to steal when the own queue is empty.
+ */
+template <class Task, class Lock, size_t kCores, size_t kLevels>
+class RunQueues {
+ public:
+  using Queue = RunQueue<Task, Lock, kLevels>;
+
+  /**
+   * @brief Place new task on the least loaded core
+   *
+   * @return core of the task
+   */
+  size_t Add(Task& task) {
+    size_t core = 0;
+    for (size_t i = 1; i < kCores; ++i) {
+      if (queues_[i].Count() < queues_[core].Count()) {
+        core = i;
+      }
+    }
+
+    task.core = core;
+    queues_[core].Push(task);
+    return core;
+  }
+
+  /**
+   * @brief Make task ready on the core it ran last
+   *
+   * @return true if the core differs from self and has to be signalled
+   */
+  bool Wake(Task& task, const size_t self) {
+    queues_[task.core].Push(task);
+    return (task.core != self);
+  }
+
+  /**
+   * @brief Take next task of the core, steal from the busiest core when
+   *        the own queue is empty
+   *
+   * @return task or nullptr when no core has queued tasks
+   */
+  Task* Next(const size_t core) {
+    Task* task = queues_[core].Pop();
+    if (task == nullptr) {
+      task = Steal(core);
+    }
+
+    return task;
+  }
+
+  Queue& operator[](const size_t core) { return queues_[core]; }
+
+ private:
+  Task* Steal(const size_t core) {
+    size_t victim = core;
+    size_t busiest = 0;
+    for (size_t i = 0; i < kCores; ++i) {
+      const size_t count = queues_[i].Count();
+      if ((i != core) && (count > busiest)) {
+        victim = i;
+        busiest = count;
+      }
+    }
+
+    if (victim == core) {
+      return nullptr;
+    }
+
+    // victim may have drained the queue since the count was read
+    Task* task = queues_[victim].Pop();
+    if (task != nullptr) {
+      task->core = core;
+    }
+
+    return task;
+  }
+
+  Queue queues_[kCores];
+};
+
+}  // namespace scheduler
+}  // namespace kernel
+
+#endif  // KERNEL_SCHEDULER_RUN_QUEUE_H_
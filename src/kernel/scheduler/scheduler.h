@@ -22,8 +22,11 @@ GNU General Public License for more details.
 
 #include "gen/arch_types_gen.h"
 #include "kernel/config.h"
+#include "kernel/cpus.h"
+#include "kernel/hal/mutex.h"
 #include "kernel/mm/memory.h"
 #include "kernel/mm/unique_ptr.h"
+#include "kernel/scheduler/dispatcher.h"
 #include "kernel/scheduler/process.h"
 
 namespace kernel {
@@ -31,7 +34,10 @@ namespace scheduler {
 
 class Scheduler {
  public:
-  Scheduler(mm::Memory& memory) : memory_(memory), process_count_(0) {}
+  using Dispatch = Dispatcher<Process, hal::Mutex, KERNEL_CPU_COUNT,
+                              KERNEL_PRIORITY_LEVELS>;
+
+  Scheduler(mm::Memory& memory) : memory_(memory) {}
 
 //  mm::UniquePointer<Process, mm::SlabAllocator> CreateProcess(
 //      const char* name, Process::Function func) {
@@ -46,56 +52,65 @@ class Scheduler {
 //    auto process = mm::UniquePointer<Process, mm::SlabAllocator>::Make(
 //        std::move(space), name, func, stack_ptr);
 
-//    processes_[process_count_] = process.Get();
-//    process_count_++;
+//    Add(*process);
 
 //    return process;
 //  }
 
+  /**
+   * @brief Make new process ready on the least loaded core
+   */
+  void Add(Process& process) {
+    const size_t core = dispatcher_.Add(process);
+    LOG(DEBUG) << "Process: " << process.Name() << " core: " << core;
+    Signal(core);
+  }
+
+  /**
+   * @brief Make process ready on the core it ran last
+   */
+  void Wake(Process& process) {
+    if (dispatcher_.Wake(process, Cpus::Local().id)) {
+      Signal(process.core);
+    }
+  }
+
   void Tick() {
-    if (enabled) {
+    const size_t core = Cpus::Local().id;
+    if (dispatcher_.Enabled(core)) {
       LOG(INFO) << "Scheduler Tick";
-      enabled = false;
-      DoTick();
-      enabled = true;
+      dispatcher_.SetEnabled(core, false);
+      dispatcher_.Tick(core);
+      dispatcher_.SetEnabled(core, true);
     } else {
       LOG(INFO) << "Ignore Scheduler Tick";
     }
   }
 
-  void DoTick() {
-    // Here should be actual shceduling algo
-    static size_t tick = 0;
-    static size_t current_process = 0;
-    current_process = (current_process + 1) % process_count_;
-
-    if ((tick % 3) == 0) {
-      current_process = 0;
-    }
-    tick++;
+  void DoTick() { dispatcher_.Tick(Cpus::Local().id); }
 
-    Select(*processes_[current_process]);
+  void Select(Process& process) {
+    dispatcher_.Select(Cpus::Local().id, process);
   }
 
-  void Select(Process& process) {
-    current_process_ = next_process_;
-    next_process_ = &process;
+  /**
+   * @brief Enable ticks of the core which executes the code
+   */
+  void Enable() { dispatcher_.SetEnabled(Cpus::Local().id, true); }
 
-    LOG(INFO) << "Switch: "
-              << ((current_process_) ? current_process_->Name() : "Null")
-              << " ->" << ((next_process_) ? next_process_->Name() : "Null");
-  }
+  Process* CurrentProcess() { return dispatcher_.Current(Cpus::Local().id); }
+  Process* ProcessToSwitch() { return dispatcher_.Next(Cpus::Local().id); }
 
-  Process* CurrentProcess() { return current_process_; }
-  Process* ProcessToSwitch() { return next_process_; }
+ private:
+  void Signal(const size_t core) {
+    // idle core waits for events, it finds the process on the next tick
+    if (core != Cpus::Local().id) {
+      arch::arm64::Cpu::SendEvent();
+    }
+  }
 
   mm::Memory& memory_;
-  Process* processes_[10];
-  size_t process_count_;
-  bool enabled = false;
-
-  Process* current_process_ = nullptr;
-  Process* next_process_ = nullptr;
+  Dispatch dispatcher_;
 };
 
 }  // namespace scheduler
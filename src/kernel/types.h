@@ -50,6 +50,14 @@ struct PageSizeInfo<PageSize::_64KB> {
   static constexpr size_t in_bytes = (1ULL << 16);
 };
 
+/**
+ * @brief The physical page allocator backend enum
+ */
+enum class PageAllocatorType {
+  BUDDY,
+  BITMAP,
+};
+
 template <PageSize kPageSize>
 struct Page {
   uint8_t data[PageSizeInfo<kPageSize>::in_bytes];
@@ -41,9 +41,10 @@ class List {
   ~List() {
     auto node = head_;
     while (node != nullptr) {
+      auto next = node->next;
       reinterpret_cast<T*>(node->buffer)->~T();
       Allocator::Deallocate(node);
-      node = node->next;
+      node = next;
     }
   }
 
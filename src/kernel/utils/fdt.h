@@ -0,0 +1,326 @@
+/*=============================================================================
+Project Z - Operating system for ARM processors
+Copyright (C) 2018 Vladyslav Samodelok <vladfux4@gmail.com>
+All rights reserved.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+=============================================================================*/
+#ifndef KERNEL_UTILS_FDT_H_
+#define KERNEL_UTILS_FDT_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace utils {
+
+/**
+ * @brief The flattened device tree reader
+ *
+ * Walks the blob in place without allocations. All blob fields are big
+ * endian and read as aligned 32 bit words, so it is safe to use before
+ * the MMU is enabled.
+ */
+class Fdt {
+ public:
+  static constexpr uint32_t kMagic = 0xD00DFEED;
+  static constexpr uint32_t kMinVersion = 16;
+  static constexpr size_t kMaxDepth = 8;
+
+  explicit Fdt(const void* blob)
+      : blob_(reinterpret_cast<const uint8_t*>(blob)) {}
+
+  bool Valid() const {
+    return (nullptr != blob_) &&
+           (0 == (reinterpret_cast<uintptr_t>(blob_) % sizeof(uint32_t))) &&
+           (kMagic == Read32(kMagicOffset)) &&
+           (Read32(kVersionOffset) >= kMinVersion);
+  }
+
+  size_t TotalSize() const { return Read32(kTotalSizeOffset); }
+
+  /**
+   * @brief Call visitor(base, length) for each reg entry of /memory nodes
+   */
+  template <class Visitor>
+  void ForEachMemory(Visitor visitor) const {
+    Cells root;
+    Walk([&](const char* const* path, size_t depth, const char* prop,
+             size_t data, uint32_t length) {
+      if (0 == depth) {
+        root.Update(*this, prop, data);
+      } else if ((1 == depth) && IsNode(path[1], "memory") &&
+                 Equal(prop, "reg")) {
+        ForEachReg(data, length, root, visitor);
+      }
+    });
+  }
+
+  /**
+   * @brief Call visitor(base, length) for each reserved range
+   *
+   * Reports memory reservation block entries and reg entries of
+   * /reserved-memory child nodes.
+   */
+  template <class Visitor>
+  void ForEachReserved(Visitor visitor) const {
+    const size_t total = TotalSize();
+    for (size_t offset = Read32(kReserveMapOffset); (offset + 16) <= total;
+         offset += 16) {
+      const uint64_t base = Read64(offset);
+      const uint64_t length = Read64(offset + 8);
+      if ((0 == base) && (0 == length)) {
+        break;
+      }
+
+      visitor(base, length);
+    }
+
+    Cells reserved;
+    Walk([&](const char* const* path, size_t depth, const char* prop,
+             size_t data, uint32_t length) {
+      if ((depth < 1) || !IsNode(path[1], "reserved-memory")) {
+        return;
+      }
+
+      if (1 == depth) {
+        reserved.Update(*this, prop, data);
+      } else if ((2 == depth) && Equal(prop, "reg")) {
+        ForEachReg(data, length, reserved, visitor);
+      }
+    });
+  }
+
+  /**
+   * @brief Call visitor(id, enable_method, release) for each /cpus/cpu node
+   *
+   * Id is the reg value (MPIDR affinity), enable method is an empty string
+   * and release is 0 if the property is absent.
+   */
+  template <class Visitor>
+  void ForEachCpu(Visitor visitor) const {
+    const char* node = nullptr;
+    uint64_t id = 0;
+    const char* method = "";
+    uint64_t release = 0;
+    Walk([&](const char* const* path, size_t depth, const char* prop,
+             size_t data, uint32_t length) {
+      if ((2 != depth) || !IsNode(path[1], "cpus") ||
+          !IsNode(path[2], "cpu")) {
+        return;
+      }
+
+      if (path[2] != node) {
+        if (nullptr != node) {
+          visitor(id, method, release);
+        }
+
+        node = path[2];
+        id = 0;
+        method = "";
+        release = 0;
+      }
+
+      if (Equal(prop, "reg")) {
+        id = ReadCells(data, (length / sizeof(uint32_t)));
+      } else if (Equal(prop, "enable-method")) {
+        method = reinterpret_cast<const char*>(blob_ + data);
+      } else if (Equal(prop, "cpu-release-addr")) {
+        release = ReadCells(data, (length / sizeof(uint32_t)));
+      }
+    });
+
+    if (nullptr != node) {
+      visitor(id, method, release);
+    }
+  }
+
+  /**
+   * @brief Get conduit of the /psci node, "hvc" or "smc", nullptr if absent
+   */
+  const char* PsciMethod() const {
+    const char* method = nullptr;
+    Walk([&](const char* const* path, size_t depth, const char* prop,
+             size_t data, uint32_t) {
+      if ((1 == depth) && IsNode(path[1], "psci") && Equal(prop, "method")) {
+        method = reinterpret_cast<const char*>(blob_ + data);
+      }
+    });
+
+    return method;
+  }
+
+  static bool Equal(const char* lhs, const char* rhs) {
+    while ((*lhs == *rhs) && ('\0' != *lhs)) {
+      lhs++;
+      rhs++;
+    }
+
+    return (*lhs == *rhs);
+  }
+
+ private:
+  enum Token : uint32_t {
+    kBeginNode = 1,
+    kEndNode = 2,
+    kProp = 3,
+    kNop = 4,
+    kEnd = 9,
+  };
+
+  static constexpr size_t kMagicOffset = 0;
+  static constexpr size_t kTotalSizeOffset = 4;
+  static constexpr size_t kStructOffset = 8;
+  static constexpr size_t kStringsOffset = 12;
+  static constexpr size_t kReserveMapOffset = 16;
+  static constexpr size_t kVersionOffset = 20;
+  static constexpr size_t kStructSizeOffset = 36;
+
+  struct Cells {
+    uint32_t address = 2;
+    uint32_t size = 1;
+
+    void Update(const Fdt& fdt, const char* prop, const size_t data) {
+      if (Equal(prop, "#address-cells")) {
+        address = fdt.Read32(data);
+      } else if (Equal(prop, "#size-cells")) {
+        size = fdt.Read32(data);
+      }
+    }
+  };
+
+  // node name matches name or name@unit-address
+  static bool IsNode(const char* node, const char* name) {
+    while (('\0' != *name) && (*node == *name)) {
+      node++;
+      name++;
+    }
+
+    return ('\0' == *name) && (('\0' == *node) || ('@' == *node));
+  }
+
+  static size_t Align(const size_t offset) {
+    return ((offset + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1));
+  }
+
+  uint32_t Read32(const size_t offset) const {
+    return __builtin_bswap32(
+        *reinterpret_cast<const uint32_t*>(blob_ + offset));
+  }
+
+  uint64_t Read64(const size_t offset) const {
+    return ((static_cast<uint64_t>(Read32(offset)) << 32) |
+            Read32(offset + 4));
+  }
+
+  uint64_t ReadCells(const size_t offset, const uint32_t cells) const {
+    return (2 == cells) ? Read64(offset) : Read32(offset);
+  }
+
+  template <class Visitor>
+  void ForEachReg(size_t data, const uint32_t length, const Cells& cells,
+                  Visitor& visitor) const {
+    const size_t entry = ((cells.address + cells.size) * sizeof(uint32_t));
+    if ((0 == entry) || (cells.address > 2) || (cells.size > 2)) {
+      return;
+    }
+
+    for (const size_t end = (data + length); (data + entry) <= end;
+         data += entry) {
+      const uint64_t base = ReadCells(data, cells.address);
+      const uint64_t size =
+          ReadCells(data + (cells.address * sizeof(uint32_t)), cells.size);
+      visitor(base, size);
+    }
+  }
+
+  /**
+   * @brief Call visitor(path, depth, prop, data, length) for each property
+   */
+  template <class Visitor>
+  void Walk(Visitor visitor) const {
+    const char* path[kMaxDepth] = {};
+    const size_t total = TotalSize();
+    const size_t strings = Read32(kStringsOffset);
+    size_t offset = Read32(kStructOffset);
+    size_t depth = 0;
+
+    // struct block is clipped to the blob, nothing is read past totalsize
+    size_t end = (offset + Read32(kStructSizeOffset));
+    if ((end > total) || (end < offset)) {
+      end = total;
+    }
+
+    while ((offset + sizeof(uint32_t)) <= end) {
+      const uint32_t token = Read32(offset);
+      offset += sizeof(uint32_t);
+
+      switch (token) {
+        case kBeginNode: {
+          auto name = reinterpret_cast<const char*>(blob_ + offset);
+          if (depth < kMaxDepth) {
+            path[depth] = name;
+          }
+
+          depth++;
+          while ((offset < end) && ('\0' != blob_[offset])) {
+            offset++;
+          }
+
+          if (offset >= end) {
+            return;
+          }
+
+          offset = Align(offset + 1);
+          break;
+        }
+        case kEndNode:
+          if (0 == depth) {
+            return;
+          }
+
+          depth--;
+          break;
+        case kProp: {
+          if ((offset + (2 * sizeof(uint32_t))) > end) {
+            return;
+          }
+
+          const uint32_t length = Read32(offset);
+          const size_t name_offset = (strings + Read32(offset + 4));
+          offset += (2 * sizeof(uint32_t));
+          if ((length > (end - offset)) || (name_offset >= total)) {
+            return;
+          }
+
+          auto name = reinterpret_cast<const char*>(blob_ + name_offset);
+          if ((0 != depth) && (depth <= kMaxDepth)) {
+            visitor(path, (depth - 1), name, offset, length);
+          }
+
+          offset = Align(offset + length);
+          break;
+        }
+        case kNop:
+          break;
+        case kEnd:
+        default:
+          return;
+      }
+    }
+  }
+
+  const uint8_t* blob_;
+};
+
+}  // namespace utils
+
+#endif  // KERNEL_UTILS_FDT_H_
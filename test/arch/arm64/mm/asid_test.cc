@@ -0,0 +1,97 @@
+#include "arch/arm64/mm/asid.h"
+
+#include <set>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using namespace arch::arm64::mm;
+
+using Asids = AsidAllocator<8, 4>;
+
+TEST(AsidTest, Unique) {
+  Asids asids;
+  std::set<uint16_t> values;
+  std::vector<uint64_t> tags(Asids::kCount - 1, Asids::kNone);
+
+  for (auto& tag : tags) {
+    EXPECT_FALSE(asids.Acquire(tag, 0));
+    EXPECT_NE(Asids::Value(tag), 0u);
+    values.insert(Asids::Value(tag));
+  }
+
+  EXPECT_EQ(values.size(), (Asids::kCount - 1));
+}
+
+TEST(AsidTest, KeptWhileCurrent) {
+  Asids asids;
+  uint64_t tag = Asids::kNone;
+  asids.Acquire(tag, 0);
+  const uint64_t first = tag;
+
+  EXPECT_FALSE(asids.Acquire(tag, 1));
+  EXPECT_EQ(tag, first);
+}
+
+TEST(AsidTest, ReleaseReuses) {
+  Asids asids;
+  std::vector<uint64_t> tags(Asids::kCount - 1, Asids::kNone);
+  for (auto& tag : tags) {
+    asids.Acquire(tag, 0);
+  }
+
+  const uint16_t freed = Asids::Value(tags[10]);
+  EXPECT_TRUE(asids.Release(tags[10]));
+  EXPECT_EQ(tags[10], Asids::kNone);
+
+  uint64_t tag = Asids::kNone;
+  EXPECT_FALSE(asids.Acquire(tag, 0));
+  EXPECT_EQ(Asids::Value(tag), freed);
+}
+
+TEST(AsidTest, Rollover) {
+  Asids asids;
+  std::vector<uint64_t> tags(Asids::kCount - 1, Asids::kNone);
+  for (std::size_t i = 0; i < tags.size(); ++i) {
+    asids.Acquire(tags[i], (i % 4));
+  }
+
+  // last acquired tags stay active on cores
+  const std::size_t first_active = (tags.size() - 4);
+
+  uint64_t tag = Asids::kNone;
+  EXPECT_TRUE(asids.Acquire(tag, 0));
+  EXPECT_EQ(asids.Generation(), 2u);
+  EXPECT_TRUE(asids.Current(tag));
+  EXPECT_FALSE(asids.Current(tags[0]));
+
+  // active spaces keep their ASIDs, nobody else gets them
+  for (std::size_t i = first_active; i < tags.size(); ++i) {
+    uint64_t kept = tags[i];
+    EXPECT_FALSE(asids.Acquire(kept, (i % 4)));
+    EXPECT_TRUE(asids.Current(kept));
+    EXPECT_EQ(Asids::Value(kept), Asids::Value(tags[i]));
+    EXPECT_NE(Asids::Value(tag), Asids::Value(tags[i]));
+  }
+
+  // stale tag gets new ASID without another rollover
+  EXPECT_FALSE(asids.Acquire(tags[0], 1));
+  EXPECT_TRUE(asids.Current(tags[0]));
+  EXPECT_EQ(asids.Generation(), 2u);
+}
+
+TEST(AsidTest, ReleaseReserved) {
+  Asids asids;
+  std::vector<uint64_t> tags(Asids::kCount - 1, Asids::kNone);
+  for (auto& tag : tags) {
+    asids.Acquire(tag, 0);
+  }
+
+  uint64_t tag = Asids::kNone;
+  asids.Acquire(tag, 1);
+
+  // space active on core 0 during rollover may have cached translations
+  EXPECT_FALSE(asids.Current(tags.back()));
+  EXPECT_TRUE(asids.Release(tags.back()));
+  EXPECT_FALSE(asids.Release(tags.front()));
+}
@@ -0,0 +1,53 @@
+#include "arch/arm64/mm/fault.h"
+
+#include "gtest/gtest.h"
+
+using namespace arch::arm64::mm;
+using arch::arm64::sys::ExceptionClass;
+
+constexpr uint64_t Esr(uint64_t ec, uint64_t iss) {
+  return ((ec << 26) | (1ULL << 25) | iss);
+}
+
+TEST(FaultTest, IsAbort) {
+  EXPECT_TRUE(Fault::IsAbort(ExceptionClass::DATA_ABORT));
+  EXPECT_TRUE(Fault::IsAbort(ExceptionClass::DATA_ABORT_LOWER));
+  EXPECT_TRUE(Fault::IsAbort(ExceptionClass::INSTRUCTION_ABORT));
+  EXPECT_TRUE(Fault::IsAbort(ExceptionClass::INSTRUCTION_ABORT_LOWER));
+  EXPECT_FALSE(Fault::IsAbort(ExceptionClass::SVC));
+}
+
+TEST(FaultTest, DataTranslationWrite) {
+  // level 3 translation fault on write
+  auto fault = Fault::Decode(Esr(0x25, (1 << 6) | 0b000111), 0xFFFFFFFFFFE80008);
+
+  EXPECT_EQ(fault.address, reinterpret_cast<void*>(0xFFFFFFFFFFE80008));
+  EXPECT_EQ(fault.type, FaultType::TRANSLATION);
+  EXPECT_EQ(fault.level, 3u);
+  EXPECT_TRUE(fault.write);
+  EXPECT_FALSE(fault.instruction);
+}
+
+TEST(FaultTest, DataPermissionRead) {
+  auto fault = Fault::Decode(Esr(0x24, 0b001110), 0x1000);
+
+  EXPECT_EQ(fault.type, FaultType::PERMISSION);
+  EXPECT_EQ(fault.level, 2u);
+  EXPECT_FALSE(fault.write);
+}
+
+TEST(FaultTest, Instruction) {
+  // WnR is not defined for instruction aborts
+  auto fault = Fault::Decode(Esr(0x21, (1 << 6) | 0b001001), 0x2000);
+
+  EXPECT_EQ(fault.type, FaultType::ACCESS_FLAG);
+  EXPECT_EQ(fault.level, 1u);
+  EXPECT_FALSE(fault.write);
+  EXPECT_TRUE(fault.instruction);
+}
+
+TEST(FaultTest, Other) {
+  // synchronous external abort
+  auto fault = Fault::Decode(Esr(0x25, 0b010000), 0x0);
+  EXPECT_EQ(fault.type, FaultType::OTHER);
+}
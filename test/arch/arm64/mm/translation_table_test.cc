@@ -0,0 +1,486 @@
+#include "arch/arm64/mm/translation_table.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace arch {
+namespace arm64 {
+namespace mm {
+
+template <typename T, std::size_t kAlignment = 0>
+class TableAllocator {
+ public:
+  static T* Make() {
+    tables++;
+    return new (aligned_alloc(kAlignment, sizeof(T))) T();
+  }
+
+  static void Deallocate(T* ptr) {
+    tables--;
+    ptr->~T();
+    free(ptr);
+  }
+
+  static inline std::size_t tables = 0;
+};
+
+using Table = TranslationTable<kernel::mm::PageSize::_4KB, 39, TableAllocator>;
+using BlockSize = Table::BlockSize;
+using Tables = TableAllocator<Table::Table, sizeof(Table::Table)>;
+
+constexpr uint64_t kContiguousBit = (1ULL << 52);
+constexpr uint64_t kXnBit = (1ULL << 54);
+constexpr uint64_t kNgBit = (1ULL << 11);
+constexpr uint64_t kAddressMask = 0x0000FFFFFFFFF000ULL;
+
+struct Leaf {
+  uint64_t descriptor;
+  std::size_t bytes;
+};
+
+// walk tables as MMU does, root of 39 bit space is level 1
+Leaf Lookup(const Table& table, const uintptr_t address) {
+  auto entries = reinterpret_cast<const uint64_t*>(table.GetBase());
+  for (std::size_t shift = 30; shift >= 12; shift -= 9) {
+    const uint64_t descriptor = entries[(address >> shift) & 511];
+    if (0 == (descriptor & 1)) {
+      return {0, 0};
+    }
+
+    if ((12 == shift) || (0b01 == (descriptor & 0b11))) {
+      return {descriptor, (1ULL << shift)};
+    }
+
+    entries = reinterpret_cast<const uint64_t*>(descriptor & kAddressMask);
+  }
+
+  return {0, 0};
+}
+
+class TranslationTableTest : public ::testing::Test {
+ protected:
+  void MapRange(uintptr_t v, uintptr_t p, std::size_t length) {
+    table.MapRange(reinterpret_cast<void*>(v), reinterpret_cast<void*>(p),
+                   length, params);
+  }
+
+  void ExpectLeaf(uintptr_t v, uintptr_t p, std::size_t bytes,
+                  bool contiguous) {
+    auto leaf = Lookup(table, v);
+    EXPECT_EQ(leaf.bytes, bytes) << "address: " << std::hex << v;
+    EXPECT_EQ((leaf.descriptor & kAddressMask), p)
+        << "address: " << std::hex << v;
+    EXPECT_EQ((0 != (leaf.descriptor & kContiguousBit)), contiguous)
+        << "address: " << std::hex << v;
+  }
+
+  Table table;
+  Table::EntryParameters params = {
+      BlockSize::_4KB, MemoryAttr::NORMAL, S2AP::NORMAL, SH::INNER_SHAREABLE,
+      AF::IGNORE,      Contiguous::OFF,    XN::EXECUTE,
+      NG::GLOBAL};
+};
+
+TEST_F(TranslationTableTest, LargestBlocks) {
+  MapRange(0x0, 0x80000000, (1ULL << 30) + (1ULL << 21) + (1ULL << 12));
+
+  ExpectLeaf(0x0, 0x80000000, (1ULL << 30), false);
+  ExpectLeaf(0x40000000, 0xC0000000, (1ULL << 21), false);
+  ExpectLeaf(0x40200000, 0xC0200000, (1ULL << 12), false);
+  EXPECT_EQ(Lookup(table, 0x40201000).descriptor, 0u);
+}
+
+TEST_F(TranslationTableTest, MisalignedPhysical) {
+  MapRange(0x200000, 0x401000, (1ULL << 21));
+
+  for (uintptr_t offset = 0; offset < (1ULL << 21); offset += 0x1000) {
+    ExpectLeaf(0x200000 + offset, 0x401000 + offset, 0x1000, false);
+  }
+}
+
+TEST_F(TranslationTableTest, ContiguousPages) {
+  // 33 pages, two hinted runs and one single page
+  MapRange(0x10000, 0x30010000, (33 * 0x1000));
+
+  for (uintptr_t page = 0; page < 33; ++page) {
+    ExpectLeaf(0x10000 + (page * 0x1000), 0x30010000 + (page * 0x1000),
+               0x1000, (page < 32));
+  }
+}
+
+TEST_F(TranslationTableTest, ContiguousPagesNotAligned) {
+  MapRange(0x11000, 0x30011000, (16 * 0x1000));
+
+  for (uintptr_t page = 0; page < 16; ++page) {
+    ExpectLeaf(0x11000 + (page * 0x1000), 0x30011000 + (page * 0x1000),
+               0x1000, false);
+  }
+}
+
+TEST_F(TranslationTableTest, ContiguousBlocks) {
+  // 17 blocks of 2MB, first 16 are hinted
+  MapRange(0x2000000, 0x6000000, (17ULL << 21));
+
+  for (uintptr_t block = 0; block < 17; ++block) {
+    ExpectLeaf(0x2000000 + (block << 21), 0x6000000 + (block << 21),
+               (1ULL << 21), (block < 16));
+  }
+}
+
+TEST_F(TranslationTableTest, NotGlobal) {
+  params.ng = NG::NOT_GLOBAL;
+  MapRange(0x1000, 0x30001000, 0x1000);
+  MapRange(0x200000, 0x30200000, (1ULL << 21));
+
+  ExpectLeaf(0x1000, 0x30001000, 0x1000, false);
+  ExpectLeaf(0x200000, 0x30200000, (1ULL << 21), false);
+  EXPECT_NE((Lookup(table, 0x1000).descriptor & kNgBit), 0u);
+  EXPECT_NE((Lookup(table, 0x200000).descriptor & kNgBit), 0u);
+}
+
+TEST_F(TranslationTableTest, UnmapPage) {
+  MapRange(0x10000, 0x30010000, (32 * 0x1000));
+  auto change = table.UnmapRange(reinterpret_cast<void*>(0x15000), 0x1000);
+
+  // hint of the first run is cleared, the run is invalidated
+  EXPECT_EQ(change.begin, 0x10000u);
+  EXPECT_EQ(change.end, 0x20000u);
+  EXPECT_FALSE(change.tables);
+  EXPECT_EQ(Lookup(table, 0x15000).descriptor, 0u);
+  for (uintptr_t page = 0; page < 32; ++page) {
+    if (5 != page) {
+      ExpectLeaf(0x10000 + (page * 0x1000), 0x30010000 + (page * 0x1000),
+                 0x1000, (page >= 16));
+    }
+  }
+}
+
+TEST_F(TranslationTableTest, UnmapFreesTables) {
+  const auto tables = Tables::tables;
+  MapRange(0x40000000, 0x1000, (2 * 0x1000));
+  EXPECT_EQ(Tables::tables, tables + 2);
+
+  auto change = table.UnmapRange(reinterpret_cast<void*>(0x40000000),
+                                 (2 * 0x1000));
+  EXPECT_TRUE(change.tables);
+  EXPECT_EQ(Tables::tables, tables);
+  EXPECT_EQ(Lookup(table, 0x40000000).descriptor, 0u);
+}
+
+TEST_F(TranslationTableTest, UnmapKeepsUsedTables) {
+  const auto tables = Tables::tables;
+  MapRange(0x40000000, 0x1000, 0x1000);
+  MapRange(0x401FF000, 0x2000, 0x1000);
+
+  table.UnmapRange(reinterpret_cast<void*>(0x40000000), 0x1000);
+  EXPECT_EQ(Tables::tables, tables + 2);
+  ExpectLeaf(0x401FF000, 0x2000, 0x1000, false);
+
+  table.UnmapRange(reinterpret_cast<void*>(0x401FF000), 0x1000);
+  EXPECT_EQ(Tables::tables, tables);
+}
+
+TEST_F(TranslationTableTest, TeardownFreesTables) {
+  const auto tables = Tables::tables;
+  {
+    Table sparse;
+    sparse.MapRange(reinterpret_cast<void*>(0x1000),
+                    reinterpret_cast<void*>(0x1000), 0x1000, params);
+    sparse.MapRange(reinterpret_cast<void*>(0x7FC0000000),
+                    reinterpret_cast<void*>(0x2000), 0x1000, params);
+    sparse.UnmapRange(reinterpret_cast<void*>(0x1000), 0x1000);
+    EXPECT_EQ(Tables::tables, tables + 3);
+  }
+  EXPECT_EQ(Tables::tables, tables);
+}
+
+TEST(TableOccupancy, Next) {
+  TableOccupancy<512> occupancy = {};
+  EXPECT_TRUE(occupancy.Empty());
+  EXPECT_EQ(occupancy.Next(0), occupancy.kNone);
+
+  occupancy.Set(3, true);
+  occupancy.Set(64, true);
+  occupancy.Set(511, true);
+  occupancy.Set(511, true);
+  EXPECT_EQ(occupancy.count, 3u);
+  EXPECT_EQ(occupancy.Next(0), 3u);
+  EXPECT_EQ(occupancy.Next(4), 64u);
+  EXPECT_EQ(occupancy.Next(65), 511u);
+  EXPECT_EQ(occupancy.Next(512), occupancy.kNone);
+
+  occupancy.Set(3, false);
+  occupancy.Set(3, false);
+  occupancy.Set(64, false);
+  occupancy.Set(511, false);
+  EXPECT_TRUE(occupancy.Empty());
+}
+
+TEST_F(TranslationTableTest, UnmapSplitsBlock) {
+  MapRange(0x200000, 0x400000, (1ULL << 21));
+  auto change = table.UnmapRange(reinterpret_cast<void*>(0x201000), 0x1000);
+
+  EXPECT_TRUE(change.tables);
+  EXPECT_EQ(change.begin, 0x200000u);
+  EXPECT_EQ(change.end, 0x400000u);
+  ExpectLeaf(0x200000, 0x400000, 0x1000, false);
+  EXPECT_EQ(Lookup(table, 0x201000).descriptor, 0u);
+  ExpectLeaf(0x3FF000, 0x5FF000, 0x1000, false);
+}
+
+TEST_F(TranslationTableTest, Protect) {
+  MapRange(0x11000, 0x30011000, (8 * 0x1000));
+  auto param = params;
+  param.xn = XN::NO_EXECUTE;
+  auto change =
+      table.Protect(reinterpret_cast<void*>(0x12000), (2 * 0x1000), param);
+
+  EXPECT_EQ(change.begin, 0x12000u);
+  EXPECT_EQ(change.end, 0x14000u);
+  for (uintptr_t page = 0; page < 8; ++page) {
+    const uintptr_t address = 0x11000 + (page * 0x1000);
+    ExpectLeaf(address, 0x30011000 + (page * 0x1000), 0x1000, false);
+    EXPECT_EQ((0 != (Lookup(table, address).descriptor & kXnBit)),
+              ((page == 1) || (page == 2)));
+  }
+}
+
+// records the entry state seen by each break-before-make flush
+struct FlushRecord {
+  static void Flush(void* context, const Table& table,
+                    const Table::Change& change) {
+    auto& record = *static_cast<FlushRecord*>(context);
+    record.flushes++;
+    record.begin = change.begin;
+    record.end = change.end;
+    record.descriptor = Lookup(table, record.address).descriptor;
+  }
+
+  uintptr_t address;
+  std::size_t flushes = 0;
+  std::size_t begin = 0;
+  std::size_t end = 0;
+  uint64_t descriptor = 0;
+};
+
+TEST_F(TranslationTableTest, SplitBreaksBeforeMake) {
+  MapRange(0x200000, 0x400000, (1ULL << 21));
+  FlushRecord record = {0x3FF000};
+  table.SetFlush(&FlushRecord::Flush, &record);
+  table.UnmapRange(reinterpret_cast<void*>(0x201000), 0x1000);
+
+  EXPECT_EQ(record.flushes, 1u);
+  EXPECT_EQ(record.begin, 0x200000u);
+  EXPECT_EQ(record.end, 0x400000u);
+  EXPECT_EQ(record.descriptor, 0u);
+  ExpectLeaf(0x3FF000, 0x5FF000, 0x1000, false);
+}
+
+TEST_F(TranslationTableTest, ContiguousBreaksBeforeMake) {
+  MapRange(0x10000, 0x30010000, (16 * 0x1000));
+  FlushRecord record = {0x1F000};
+  table.SetFlush(&FlushRecord::Flush, &record);
+  auto param = params;
+  param.xn = XN::NO_EXECUTE;
+  table.Protect(reinterpret_cast<void*>(0x15000), 0x1000, param);
+
+  // whole run is invalid while its hint is cleared, permission change of
+  // the page itself needs no break
+  EXPECT_EQ(record.flushes, 1u);
+  EXPECT_EQ(record.begin, 0x10000u);
+  EXPECT_EQ(record.end, 0x20000u);
+  EXPECT_EQ(record.descriptor, 0u);
+  ExpectLeaf(0x1F000, 0x3001F000, 0x1000, false);
+  ExpectLeaf(0x15000, 0x30015000, 0x1000, false);
+}
+
+TEST_F(TranslationTableTest, ProtectAttributeBreaksBeforeMake) {
+  MapRange(0x11000, 0x30011000, 0x1000);
+  FlushRecord record = {0x11000};
+  table.SetFlush(&FlushRecord::Flush, &record);
+  auto param = params;
+  param.mem_attr = MemoryAttr::NORMAL_NC;
+  table.Protect(reinterpret_cast<void*>(0x11000), 0x1000, param);
+
+  EXPECT_EQ(record.flushes, 1u);
+  EXPECT_EQ(record.descriptor, 0u);
+  ExpectLeaf(0x11000, 0x30011000, 0x1000, false);
+}
+
+TEST_F(TranslationTableTest, MapInsideBlockSplits) {
+  MapRange(0x200000, 0x400000, (1ULL << 21));
+  MapRange(0x201000, 0x900000, 0x1000);
+
+  ExpectLeaf(0x200000, 0x400000, 0x1000, false);
+  ExpectLeaf(0x201000, 0x900000, 0x1000, false);
+  ExpectLeaf(0x3FF000, 0x5FF000, 0x1000, false);
+}
+
+TEST_F(TranslationTableTest, MapBlockOverTable) {
+  const auto tables = Tables::tables;
+  MapRange(0x200000, 0x400000, 0x1000);
+  EXPECT_EQ(table.Translate(reinterpret_cast<void*>(0x200000)).address,
+            0x400000u);
+  EXPECT_EQ(Tables::tables, tables + 2);
+
+  // leaf table is freed and not reached through the walk cache
+  MapRange(0x200000, 0x800000, (1ULL << 21));
+  EXPECT_EQ(Tables::tables, tables + 1);
+  ExpectLeaf(0x200000, 0x800000, (1ULL << 21), false);
+  auto out = table.Translate(reinterpret_cast<void*>(0x201000));
+  EXPECT_EQ(out.address, 0x801000u);
+  EXPECT_EQ(out.bytes, (1ULL << 21));
+}
+
+TEST_F(TranslationTableTest, ShareRoot) {
+  MapRange(0x200000, 0x200000, (1ULL << 21));
+  const auto tables = Tables::tables;
+
+  {
+    Table user;
+    user.Share(table);
+    EXPECT_EQ(table.Sharers(), 1u);
+
+    // only the user root table is allocated
+    EXPECT_EQ(Tables::tables, tables + 1);
+    EXPECT_EQ(Lookup(user, 0x200000).descriptor, Lookup(table, 0x200000).descriptor);
+
+    user.MapRange(reinterpret_cast<void*>(0x40000000),
+                  reinterpret_cast<void*>(0x1000), 0x1000, params);
+    EXPECT_NE(Lookup(user, 0x40000000).descriptor, 0u);
+    EXPECT_EQ(Lookup(table, 0x40000000).descriptor, 0u);
+
+    // shared entries are not changed through the sharer
+    user.UnmapRange(reinterpret_cast<void*>(0x200000), (1ULL << 21));
+    EXPECT_NE(Lookup(table, 0x200000).descriptor, 0u);
+
+    // new kernel root entry is seen by the sharer at once
+    MapRange(0x80000000, 0x80000000, (1ULL << 30));
+    ExpectLeaf(0x80000000, 0x80000000, (1ULL << 30), false);
+    EXPECT_EQ(Lookup(user, 0x80000000).descriptor,
+              Lookup(table, 0x80000000).descriptor);
+  }
+
+  // sharer frees only own tables
+  EXPECT_EQ(table.Sharers(), 0u);
+  EXPECT_EQ(Tables::tables, tables);
+  ExpectLeaf(0x200000, 0x200000, (1ULL << 21), false);
+}
+
+TEST_F(TranslationTableTest, ShareRootFreed) {
+  MapRange(0x200000, 0x200000, 0x1000);
+
+  Table first, second;
+  first.Share(table);
+  second.Share(table);
+  const auto tables = Tables::tables;
+  EXPECT_EQ(table.Sharers(), 2u);
+  ASSERT_NE(Lookup(first, 0x200000).descriptor, 0u);
+
+  // source frees the tables below its root entry, sharers drop the link
+  table.UnmapRange(reinterpret_cast<void*>(0x200000), 0x1000);
+  EXPECT_EQ(Tables::tables, tables - 2);
+  EXPECT_EQ(Lookup(first, 0x200000).descriptor, 0u);
+  EXPECT_EQ(Lookup(second, 0x200000).descriptor, 0u);
+  EXPECT_EQ(first.Translate(reinterpret_cast<void*>(0x200000)).bytes, 0u);
+
+  // entry which is used by the sharer is kept
+  first.MapRange(reinterpret_cast<void*>(0x40000000),
+                 reinterpret_cast<void*>(0x1000), 0x1000, params);
+  MapRange(0x40000000, 0x40000000, (1ULL << 30));
+  EXPECT_EQ(first.Translate(reinterpret_cast<void*>(0x40000000)).address,
+            0x1000u);
+  EXPECT_EQ(second.Translate(reinterpret_cast<void*>(0x40000000)).address,
+            0x40000000u);
+}
+
+TEST_F(TranslationTableTest, Translate) {
+  MapRange(0x10000, 0x30010000, (2 * 0x1000));
+  MapRange(0x400000, 0x600000, (1ULL << 21));
+
+  auto page = table.Translate(reinterpret_cast<void*>(0x11234));
+  EXPECT_TRUE(page.Valid());
+  EXPECT_EQ(page.address, 0x30011234u);
+  EXPECT_EQ(page.bytes, 0x1000u);
+
+  // second lookup in the window is served by the cached leaf table
+  page = table.Translate(reinterpret_cast<void*>(0x10008));
+  EXPECT_EQ(page.address, 0x30010008u);
+  EXPECT_FALSE(table.Translate(reinterpret_cast<void*>(0x12000)).Valid());
+
+  auto block = table.Translate(reinterpret_cast<void*>(0x512345));
+  EXPECT_EQ(block.address, 0x712345u);
+  EXPECT_EQ(block.bytes, (1ULL << 21));
+
+  EXPECT_FALSE(table.Translate(reinterpret_cast<void*>(0x40000000)).Valid());
+}
+
+TEST_F(TranslationTableTest, TranslateAfterUnmap) {
+  MapRange(0x10000, 0x30010000, 0x1000);
+  EXPECT_TRUE(table.Translate(reinterpret_cast<void*>(0x10000)).Valid());
+
+  // leaf table is freed, cached pointer must not be used
+  table.UnmapRange(reinterpret_cast<void*>(0x10000), 0x1000);
+  EXPECT_FALSE(table.Translate(reinterpret_cast<void*>(0x10000)).Valid());
+
+  MapRange(0x10000, 0x50010000, 0x1000);
+  EXPECT_EQ(table.Translate(reinterpret_cast<void*>(0x10000)).address,
+            0x50010000u);
+}
+
+TEST_F(TranslationTableTest, RangeMatchesPages) {
+  Table pages;
+  params.size = BlockSize::_4KB;
+  for (uintptr_t page = 0; page < 1000; ++page) {
+    pages.Map(reinterpret_cast<void*>(0x7FF000 + (page * 0x1000)),
+              reinterpret_cast<void*>(0x1001000 + (page * 0x1000)), params);
+  }
+
+  MapRange(0x7FF000, 0x1001000, (1000 * 0x1000));
+  for (uintptr_t page = 0; page < 1000; ++page) {
+    const uintptr_t address = 0x7FF000 + (page * 0x1000);
+    EXPECT_EQ(Lookup(table, address).descriptor,
+              Lookup(pages, address).descriptor);
+  }
+}
+
+// Map 400MB by 4KB pages, physical address is not aligned for blocks,
+// timings are only printed. Run with --gtest_also_run_disabled_tests
+TEST(TranslationTableBenchmark, DISABLED_MapRange) {
+  using Clock = std::chrono::steady_clock;
+  constexpr std::size_t kPages = 100000;
+  Table::EntryParameters params = {
+      BlockSize::_4KB, MemoryAttr::NORMAL, S2AP::NORMAL, SH::INNER_SHAREABLE,
+      AF::IGNORE,      Contiguous::OFF,    XN::EXECUTE,
+      NG::GLOBAL};
+
+  Table by_page;
+  auto begin = Clock::now();
+  for (std::size_t page = 0; page < kPages; ++page) {
+    by_page.Map(reinterpret_cast<void*>(page * 0x1000),
+                reinterpret_cast<void*>(0x1000 + (page * 0x1000)), params);
+  }
+  auto end = Clock::now();
+  const double page_ns =
+      std::chrono::duration<double, std::nano>(end - begin).count() / kPages;
+
+  Table by_range;
+  begin = Clock::now();
+  by_range.MapRange(reinterpret_cast<void*>(0), reinterpret_cast<void*>(0x1000),
+                    (kPages * 0x1000), params);
+  end = Clock::now();
+  const double range_ns =
+      std::chrono::duration<double, std::nano>(end - begin).count() / kPages;
+
+  std::cout << "Map per page: " << page_ns << " ns, MapRange: " << range_ns
+            << " ns" << std::endl;
+}
+
+}  // namespace mm
+}  // namespace arm64
+}  // namespace arch
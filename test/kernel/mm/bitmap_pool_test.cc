@@ -0,0 +1,207 @@
+#include "kernel/mm/bitmap_pool.h"
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "kernel/mm/buddy_pool.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "test_allocator.h"
+
+using BitmapPool = kernel::mm::BitmapPool<uint8_t, size_t, Allocator>;
+
+class BitmapPoolTest : public ::testing::Test {
+ protected:
+  BitmapPoolTest() : pool(1000), used(1000, false) {}
+
+  void Take(size_t index, size_t count, size_t align) {
+    ASSERT_NE(index, BitmapPool::kNoIndex);
+    EXPECT_EQ(index % align, 0u);
+    ASSERT_LE(index + count, used.size());
+    for (size_t i = index; i < index + count; ++i) {
+      EXPECT_FALSE(used[i]) << "index: " << i;
+      used[i] = true;
+    }
+  }
+
+  void Release(size_t index, size_t count) {
+    pool.DeallocateRun(index, count);
+    for (size_t i = index; i < index + count; ++i) {
+      used[i] = false;
+    }
+  }
+
+  // a free aligned run exists in the reference bitmap
+  bool Fits(size_t count, size_t align) {
+    for (size_t index = 0; (index + count) <= used.size(); index += align) {
+      size_t i = index;
+      while ((i < (index + count)) && !used[i]) {
+        i++;
+      }
+
+      if (i == (index + count)) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  void Check() {
+    for (size_t i = 0; i < used.size(); ++i) {
+      EXPECT_EQ(pool.IsFree(i), !used[i]) << "index: " << i;
+    }
+  }
+
+  BitmapPool pool;
+  std::vector<bool> used;
+};
+
+TEST_F(BitmapPoolTest, Init) {
+  EXPECT_EQ(pool.Size(), 1000u);
+  EXPECT_TRUE(pool.Empty());
+  Check();
+}
+
+TEST_F(BitmapPoolTest, FirstFree) {
+  for (size_t i = 0; i < 130; ++i) {
+    EXPECT_EQ(pool.AllocateByIndex(), i);
+  }
+
+  pool.DeallocateByIndex(70);
+  EXPECT_EQ(pool.AllocateByIndex(), 70u);
+  EXPECT_EQ(pool.FreeSlots(), 870u);
+}
+
+TEST_F(BitmapPoolTest, AlignedBlocks) {
+  Take(pool.AllocateByIndex(), 1, 1);
+  Take(pool.AllocateByIndex(3), 8, 8);
+  Take(pool.AllocateByIndex(6), 64, 64);
+  Take(pool.AllocateByIndex(8), 256, 256);
+  Check();
+
+  EXPECT_EQ(pool.FreeBlocks(8), 1u);
+  EXPECT_EQ(pool.AllocateByIndex(9), BitmapPool::kNoIndex);
+}
+
+TEST_F(BitmapPoolTest, RunAcrossWords) {
+  for (size_t i = 0; i < 60; ++i) {
+    Take(pool.AllocateByIndex(), 1, 1);
+  }
+
+  // 4 free bits left in the first word
+  auto index = pool.AllocateRun(10);
+  EXPECT_EQ(index, 60u);
+  Take(index, 10, 1);
+  Check();
+}
+
+TEST_F(BitmapPoolTest, SmallRunWideAlign) {
+  Take(pool.AllocateRun(1), 1, 1);
+  auto index = pool.AllocateRun(1, 128);
+  EXPECT_EQ(index, 128u);
+  Take(index, 1, 128);
+  index = pool.AllocateRun(32, 256);
+  EXPECT_EQ(index, 256u);
+  Take(index, 32, 256);
+  Check();
+}
+
+TEST_F(BitmapPoolTest, LongRunInsideWord) {
+  for (size_t i = 0; i < 10; ++i) {
+    Take(pool.AllocateByIndex(), 1, 1);
+  }
+  Take(pool.AllocateRun(1, 256), 1, 256);
+
+  // pages 10..255 are free, the run starts inside the first word
+  auto index = pool.AllocateRun(200);
+  EXPECT_EQ(index, 10u);
+  Take(index, 200, 1);
+  Check();
+}
+
+TEST_F(BitmapPoolTest, Random) {
+  std::mt19937 random(7);
+  std::vector<std::pair<size_t, size_t>> runs;
+
+  for (size_t step = 0; step < 5000; ++step) {
+    if ((random() % 2) && !runs.empty()) {
+      auto it = runs.begin() + (random() % runs.size());
+      Release(it->first, it->second);
+      runs.erase(it);
+    } else {
+      const size_t count = 1 + (random() % 200);
+      const size_t align = (1ULL << (random() % 9));
+      auto index = pool.AllocateRun(count, align);
+      if (index != BitmapPool::kNoIndex) {
+        Take(index, count, align);
+        runs.push_back({index, count});
+      } else {
+        EXPECT_FALSE(Fits(count, align))
+            << "count: " << count << " align: " << align;
+      }
+    }
+  }
+
+  Check();
+}
+
+TEST_F(BitmapPoolTest, Cut) {
+  pool.Cut(100);
+  EXPECT_EQ(pool.Size(), 100u);
+  EXPECT_EQ(pool.AllocateRun(101), BitmapPool::kNoIndex);
+  EXPECT_EQ(pool.AllocateRun(100), 0u);
+}
+
+// Compare bitmap and buddy page pools on a 880MB sized pool, timings are
+// only printed. Run with --gtest_also_run_disabled_tests
+TEST(PagePoolBenchmark, DISABLED_BitmapVsBuddy) {
+  constexpr size_t kPages = (880ULL << 20) >> 12;
+  constexpr size_t kSamples = 100000;
+  using BuddyPool = kernel::mm::BuddyPool<uint8_t, uint32_t, 9, Allocator>;
+  using Clock = std::chrono::steady_clock;
+
+  auto run = [](auto& pool, uint8_t order, size_t samples) {
+    std::vector<size_t> indexes;
+    indexes.reserve(samples);
+
+    auto begin = Clock::now();
+    for (size_t i = 0; i < samples; ++i) {
+      indexes.push_back(pool.AllocateByIndex(order));
+    }
+    for (size_t i = 0; i < samples; i += 2) {
+      pool.DeallocateByIndex(indexes[i], order);
+    }
+    for (size_t i = 0; i < samples; i += 2) {
+      indexes[i] = pool.AllocateByIndex(order);
+    }
+    for (auto index : indexes) {
+      pool.DeallocateByIndex(index, order);
+    }
+    auto end = Clock::now();
+
+    EXPECT_TRUE(pool.Empty());
+    return std::chrono::duration<double, std::nano>(end - begin).count() /
+           (samples * 3);
+  };
+
+  auto init_begin = Clock::now();
+  BuddyPool buddy(kPages);
+  auto init_buddy = Clock::now();
+  BitmapPool bitmap(kPages);
+  auto init_bitmap = Clock::now();
+
+  std::cout << "init buddy: "
+            << std::chrono::duration<double, std::micro>(init_buddy - init_begin).count()
+            << " us, bitmap: "
+            << std::chrono::duration<double, std::micro>(init_bitmap - init_buddy).count()
+            << " us" << std::endl;
+
+  std::cout << "page buddy: " << run(buddy, 0, kSamples)
+            << " ns, bitmap: " << run(bitmap, 0, kSamples) << " ns" << std::endl;
+  std::cout << "2MB block buddy: " << run(buddy, 9, 200)
+            << " ns, bitmap: " << run(bitmap, 9, 200) << " ns" << std::endl;
+}
@@ -0,0 +1,98 @@
+#include "kernel/mm/buddy_pool.h"
+
+#include <set>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "test_allocator.h"
+
+class BuddyPoolTest : public ::testing::Test {
+ protected:
+  static constexpr uint8_t kMaxOrder = 4;
+  using Pool = kernel::mm::BuddyPool<uint32_t, size_t, kMaxOrder, Allocator>;
+
+  BuddyPoolTest() : pool(64) {}
+
+  Pool pool;
+};
+
+TEST_F(BuddyPoolTest, Init) {
+  EXPECT_EQ(pool.Size(), 64u);
+  EXPECT_EQ(pool.FreeSlots(), 64u);
+  EXPECT_EQ(pool.FreeBlocks(kMaxOrder), 4u);
+  EXPECT_TRUE(pool.Empty());
+}
+
+TEST_F(BuddyPoolTest, InitNotAlignedSize) {
+  Pool small(23);
+  EXPECT_EQ(small.FreeSlots(), 23u);
+  EXPECT_EQ(small.FreeBlocks(4), 1u);
+  EXPECT_EQ(small.FreeBlocks(2), 1u);
+  EXPECT_EQ(small.FreeBlocks(1), 1u);
+  EXPECT_EQ(small.FreeBlocks(0), 1u);
+}
+
+TEST_F(BuddyPoolTest, SplitAndAlignment) {
+  for (uint8_t order = 0; order <= kMaxOrder; ++order) {
+    auto index = pool.AllocateByIndex(order);
+    ASSERT_NE(index, Pool::kNoIndex);
+    EXPECT_EQ(index % Pool::BlockSize(order), 0u);
+  }
+
+  EXPECT_EQ(pool.FreeSlots(), 64u - 31u);
+}
+
+TEST_F(BuddyPoolTest, Coalescing) {
+  std::vector<size_t> pages;
+  for (size_t i = 0; i < pool.Size(); ++i) {
+    pages.push_back(pool.AllocateByIndex(0));
+  }
+
+  EXPECT_EQ(pool.AllocateByIndex(0), Pool::kNoIndex);
+  EXPECT_EQ(pool.FreeSlots(), 0u);
+
+  for (auto page : pages) {
+    pool.DeallocateByIndex(page, 0);
+  }
+
+  EXPECT_TRUE(pool.Empty());
+  EXPECT_EQ(pool.FreeBlocks(kMaxOrder), 4u);
+  for (uint8_t order = 0; order < kMaxOrder; ++order) {
+    EXPECT_EQ(pool.FreeBlocks(order), 0u);
+  }
+}
+
+TEST_F(BuddyPoolTest, NoOverlap) {
+  std::set<size_t> used;
+  std::vector<std::pair<size_t, uint8_t>> blocks;
+
+  for (uint8_t order : {0, 2, 1, 3, 0, 0, 2, 1, 3}) {
+    auto index = pool.AllocateByIndex(order);
+    ASSERT_NE(index, Pool::kNoIndex);
+    for (size_t i = index; i < index + Pool::BlockSize(order); ++i) {
+      EXPECT_TRUE(used.insert(i).second);
+    }
+    blocks.push_back({index, order});
+  }
+
+  for (size_t i = 0; i < blocks.size(); i += 2) {
+    pool.DeallocateByIndex(blocks[i].first, blocks[i].second);
+  }
+
+  for (size_t i = 1; i < blocks.size(); i += 2) {
+    pool.DeallocateByIndex(blocks[i].first, blocks[i].second);
+  }
+
+  EXPECT_TRUE(pool.Empty());
+  EXPECT_EQ(pool.FreeBlocks(kMaxOrder), 4u);
+}
+
+TEST_F(BuddyPoolTest, Cut) {
+  pool.Cut(40);
+  EXPECT_EQ(pool.Size(), 40u);
+  EXPECT_EQ(pool.FreeBlocks(kMaxOrder), 2u);
+  EXPECT_EQ(pool.FreeBlocks(3), 1u);
+  EXPECT_EQ(pool.AllocateByIndex(kMaxOrder + 1), Pool::kNoIndex);
+}
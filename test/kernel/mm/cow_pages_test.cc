@@ -0,0 +1,173 @@
+#include "kernel/mm/cow_pages.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+using kernel::mm::PageInfo;
+
+constexpr std::size_t kPageBytes = kernel::mm::PagePool::kPageBytes;
+
+struct TestPages {
+  static void* Allocate(const uint8_t order) {
+    if (fail) {
+      return nullptr;
+    }
+
+    void* ptr = aligned_alloc(kPageBytes, (kPageBytes << order));
+    infos[ptr] = {};
+    return ptr;
+  }
+
+  static void Deallocate(void* ptr, const uint8_t order) {
+    EXPECT_EQ(order, 0u);
+    infos.erase(ptr);
+    free(ptr);
+  }
+
+  static PageInfo* Info(const void* ptr) {
+    return &infos.at(const_cast<void*>(ptr));
+  }
+
+  static inline std::map<void*, PageInfo> infos;
+  static inline bool fail = false;
+};
+
+template <typename T, std::size_t>
+struct NodeAllocator {
+  static T* Allocate() { return reinterpret_cast<T*>(malloc(sizeof(T))); }
+  static void Deallocate(T* ptr) { free(ptr); }
+};
+
+using Space = kernel::mm::CowPages<TestPages, NodeAllocator>;
+
+class CowPagesTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    TestPages::fail = false;
+    original = TestPages::Allocate(0);
+    memset(original, 0x5A, kPageBytes);
+  }
+
+  void TearDown() override {
+    TestPages::Deallocate(original, 0);
+    EXPECT_TRUE(TestPages::infos.empty());
+  }
+
+  std::unique_ptr<Space> Share() {
+    auto space = std::make_unique<Space>();
+    Space::Share(original);
+    return space;
+  }
+
+  void Destroy(std::unique_ptr<Space>& space) {
+    space->Unshare(&region, 0, original);
+    space.reset();
+  }
+
+  uint16_t Refs() { return TestPages::Info(original)->cow_refs; }
+
+  int region = 0;
+  void* original = nullptr;
+};
+
+TEST_F(CowPagesTest, CopyThenTakeOver) {
+  auto first = Share();
+  auto second = Share();
+  EXPECT_EQ(Refs(), 2u);
+
+  void* copy = first->Write(&region, 0, original);
+  ASSERT_NE(copy, nullptr);
+  EXPECT_NE(copy, original);
+  EXPECT_EQ(memcmp(copy, original, kPageBytes), 0);
+  EXPECT_TRUE(first->Copied(&region, 0));
+  EXPECT_EQ(Refs(), 1u);
+
+  // the last sharer takes the original without a copy
+  EXPECT_EQ(second->Write(&region, 0, original), original);
+  EXPECT_TRUE(second->Copied(&region, 0));
+  EXPECT_EQ(Refs(), 0u);
+  EXPECT_EQ(TestPages::infos.size(), 2u);
+
+  Destroy(first);
+  Destroy(second);
+  EXPECT_EQ(Refs(), 0u);
+  EXPECT_EQ(TestPages::infos.size(), 1u);
+}
+
+TEST_F(CowPagesTest, SecondWriteKeepsPrivatePage) {
+  auto first = Share();
+  auto second = Share();
+
+  void* copy = first->Write(&region, 0, original);
+  ASSERT_NE(copy, original);
+  EXPECT_EQ(first->Write(&region, 0, original), copy);
+  EXPECT_EQ(Refs(), 1u);
+  EXPECT_EQ(TestPages::infos.size(), 2u);
+
+  EXPECT_EQ(second->Write(&region, 0, original), original);
+  EXPECT_EQ(second->Write(&region, 0, original), original);
+  EXPECT_EQ(Refs(), 0u);
+
+  Destroy(first);
+  Destroy(second);
+  EXPECT_EQ(Refs(), 0u);
+}
+
+TEST_F(CowPagesTest, SharerDestroyedBeforeCopy) {
+  auto first = Share();
+  auto second = Share();
+
+  Destroy(second);
+  EXPECT_EQ(Refs(), 1u);
+
+  EXPECT_EQ(first->Write(&region, 0, original), original);
+  EXPECT_EQ(Refs(), 0u);
+  EXPECT_EQ(TestPages::infos.size(), 1u);
+  Destroy(first);
+}
+
+TEST_F(CowPagesTest, SharerDestroyedAfterCopy) {
+  auto first = Share();
+  auto second = Share();
+  auto third = Share();
+
+  ASSERT_NE(first->Write(&region, 0, original), original);
+  EXPECT_EQ(Refs(), 2u);
+
+  // the copy is freed, the original keeps the other two sharers
+  Destroy(first);
+  EXPECT_EQ(Refs(), 2u);
+  EXPECT_EQ(TestPages::infos.size(), 1u);
+
+  ASSERT_NE(second->Write(&region, 0, original), original);
+  EXPECT_EQ(Refs(), 1u);
+  EXPECT_EQ(third->Write(&region, 0, original), original);
+  EXPECT_EQ(Refs(), 0u);
+
+  Destroy(second);
+  Destroy(third);
+  EXPECT_EQ(TestPages::infos.size(), 1u);
+}
+
+TEST_F(CowPagesTest, CopyFailureKeepsSharing) {
+  auto first = Share();
+  auto second = Share();
+
+  TestPages::fail = true;
+  EXPECT_EQ(first->Write(&region, 0, original), nullptr);
+  EXPECT_FALSE(first->Copied(&region, 0));
+  EXPECT_EQ(Refs(), 2u);
+
+  Destroy(first);
+  Destroy(second);
+  EXPECT_EQ(Refs(), 0u);
+}
+
+}  // namespace
@@ -0,0 +1,144 @@
+#include "kernel/mm/heap.h"
+
+#include <cstdlib>
+#include <map>
+#include <set>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace {
+
+using kernel::mm::PageInfo;
+
+constexpr std::size_t kPageBytes = kernel::mm::PagePool::kPageBytes;
+
+// Page blocks from the host heap, page info is kept after free to check
+// what the heap leaves behind
+struct TestPages {
+  static void* Allocate(const uint8_t order) {
+    const std::size_t bytes = (kPageBytes << order);
+    void* ptr = aligned_alloc(bytes, bytes);
+    infos[Page(ptr)] = {};
+    live[ptr] = order;
+    return ptr;
+  }
+
+  static void Deallocate(void* ptr, const uint8_t order) {
+    EXPECT_EQ(live.at(ptr), order);
+    live.erase(ptr);
+    freed.push_back(ptr);
+    free(ptr);
+  }
+
+  static PageInfo* Info(const void* ptr) {
+    auto it = infos.find(Page(ptr));
+    return (infos.end() != it) ? &it->second : nullptr;
+  }
+
+  static uintptr_t Page(const void* ptr) {
+    return (reinterpret_cast<uintptr_t>(ptr) & ~(kPageBytes - 1));
+  }
+
+  static inline std::map<uintptr_t, PageInfo> infos;
+  static inline std::map<void*, uint8_t> live;
+  static inline std::vector<void*> freed;
+};
+
+using Heap = kernel::mm::HeapBase<TestPages>;
+
+class HeapTest : public ::testing::Test {
+ protected:
+  void SetUp() override { TestPages::freed.clear(); }
+
+  void TearDown() override {
+    kernel::mm::PageSlabAllocatorBase::Reclaim();
+    EXPECT_TRUE(TestPages::live.empty());
+  }
+};
+
+TEST_F(HeapTest, AllocFreePerClass) {
+  for (std::size_t index = 0; index < Heap::kClassCount; ++index) {
+    const std::size_t size = Heap::ClassSize(index);
+    ASSERT_EQ(Heap::ClassIndex(size), index);
+
+    std::vector<uint8_t*> objects;
+    std::set<uintptr_t> pages;
+    for (std::size_t i = 0; i < 64; ++i) {
+      auto ptr = reinterpret_cast<uint8_t*>(Heap::Allocate(size));
+      ASSERT_NE(ptr, nullptr);
+      EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr) % 8, 0u);
+      EXPECT_EQ(TestPages::Info(ptr)->heap_class, index + 1);
+      ptr[0] = static_cast<uint8_t>(i);
+      ptr[size - 1] = static_cast<uint8_t>(i);
+      objects.push_back(ptr);
+      pages.insert(TestPages::Page(ptr));
+    }
+
+    for (std::size_t i = 0; i < objects.size(); ++i) {
+      EXPECT_EQ(objects[i][0], static_cast<uint8_t>(i));
+      EXPECT_EQ(objects[i][size - 1], static_cast<uint8_t>(i));
+      Heap::Deallocate(objects[i]);
+    }
+
+    // released slab pages are not heap pages any more
+    kernel::mm::PageSlabAllocatorBase::Reclaim();
+    for (auto page : pages) {
+      EXPECT_EQ(TestPages::live.count(reinterpret_cast<void*>(page)), 0u);
+      EXPECT_EQ(TestPages::Info(reinterpret_cast<void*>(page))->heap_class,
+                Heap::kNoClass);
+    }
+  }
+}
+
+TEST_F(HeapTest, SizeRoundsUpToClass) {
+  void* small = Heap::Allocate(1);
+  void* middle = Heap::Allocate(100);
+  void* biggest = Heap::Allocate(Heap::kMaxClassSize);
+  EXPECT_EQ(TestPages::Info(small)->heap_class, 1u);
+  EXPECT_EQ(TestPages::Info(middle)->heap_class, Heap::ClassIndex(128) + 1);
+  EXPECT_EQ(TestPages::Info(biggest)->heap_class, Heap::kClassCount);
+
+  Heap::Deallocate(small);
+  Heap::Deallocate(middle);
+  Heap::Deallocate(biggest);
+}
+
+TEST_F(HeapTest, LargeAllocation) {
+  const std::size_t sizes[] = {Heap::kMaxClassSize + 1, kPageBytes,
+                               (3 * kPageBytes) + 1};
+  const uint8_t orders[] = {0, 0, 2};
+
+  for (std::size_t i = 0; i < 3; ++i) {
+    void* ptr = Heap::Allocate(sizes[i]);
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr) % kPageBytes, 0u);
+    EXPECT_EQ(TestPages::Info(ptr)->heap_class, Heap::kLargeClass);
+    EXPECT_EQ(TestPages::Info(ptr)->order, orders[i]);
+    EXPECT_EQ(TestPages::live.at(ptr), orders[i]);
+
+    Heap::Deallocate(ptr);
+    EXPECT_EQ(TestPages::live.count(ptr), 0u);
+    EXPECT_EQ(TestPages::Info(ptr)->heap_class, Heap::kNoClass);
+  }
+
+  EXPECT_EQ(Heap::Allocate(kPageBytes << (kernel::mm::PagePool::kMaxOrder + 1)),
+            nullptr);
+}
+
+TEST_F(HeapTest, InvalidFree) {
+  EXPECT_EQ(Heap::Allocate(0), nullptr);
+  Heap::Deallocate(nullptr);
+
+  uint64_t foreign = 0;
+  Heap::Deallocate(&foreign);
+
+  // page which is not taken by the heap
+  void* page = TestPages::Allocate(0);
+  Heap::Deallocate(page);
+  EXPECT_EQ(TestPages::live.count(page), 1u);
+  TestPages::Deallocate(page, 0);
+}
+
+}  // namespace
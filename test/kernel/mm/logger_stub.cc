@@ -0,0 +1,15 @@
+#include "kernel/logger.h"
+
+namespace kernel {
+namespace log {
+
+void InitPrint() {}
+void Print(const char* s) { (void)s; }
+void Print(const char* s, const uint64_t d) {
+  (void)s;
+  (void)d;
+}
+void PrintHex(const uint64_t d) { (void)d; }
+
+}  // namespace log
+}  // namespace kernel
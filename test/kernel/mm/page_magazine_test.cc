@@ -0,0 +1,76 @@
+#include "kernel/mm/page_magazine.h"
+
+#include <vector>
+
+#include "kernel/mm/pool.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "test_allocator.h"
+
+struct LockMock {
+  void Lock() { locks++; }
+  void Unlock() {}
+
+  size_t locks = 0;
+};
+
+class PageMagazineTest : public ::testing::Test {
+ protected:
+  using Magazine = kernel::mm::PageMagazine<size_t, 8>;
+
+  PageMagazineTest() : pool(64) {}
+
+  kernel::mm::Pool<uint32_t, size_t, Allocator> pool;
+  Magazine magazine;
+  LockMock lock;
+};
+
+TEST_F(PageMagazineTest, RefillInBatches) {
+  auto index = magazine.Allocate(pool, lock);
+  EXPECT_NE(index, Magazine::kNoIndex);
+  EXPECT_EQ(magazine.Count(), Magazine::kBatch - 1);
+  EXPECT_EQ(pool.FreeSlots(), 64u - Magazine::kBatch);
+
+  for (size_t i = 1; i < Magazine::kBatch; ++i) {
+    magazine.Allocate(pool, lock);
+  }
+
+  EXPECT_EQ(lock.locks, 1u);
+  EXPECT_EQ(magazine.Stats().hits, Magazine::kBatch - 1);
+  EXPECT_EQ(magazine.Stats().misses, 1u);
+  EXPECT_EQ(magazine.Stats().refills, 1u);
+
+  magazine.Allocate(pool, lock);
+  EXPECT_EQ(lock.locks, 2u);
+  EXPECT_EQ(magazine.Stats().refills, 2u);
+}
+
+TEST_F(PageMagazineTest, DrainWhenFull) {
+  std::vector<size_t> pages;
+  for (size_t i = 0; i < 16; ++i) {
+    pages.push_back(pool.AllocateByIndex());
+  }
+
+  for (auto page : pages) {
+    magazine.Deallocate(pool, lock, page);
+  }
+
+  EXPECT_EQ(magazine.Stats().drains, 2u);
+  EXPECT_EQ(magazine.Count(), 8u);
+  EXPECT_EQ(pool.FreeSlots(), 64u - 8u);
+
+  magazine.Flush(pool, lock);
+  EXPECT_EQ(magazine.Count(), 0u);
+  EXPECT_TRUE(pool.Empty());
+}
+
+TEST_F(PageMagazineTest, PoolExhausted) {
+  while (pool.FreeSlots() != 0) {
+    pool.AllocateByIndex();
+  }
+
+  EXPECT_EQ(magazine.Allocate(pool, lock), Magazine::kNoIndex);
+  EXPECT_EQ(magazine.Stats().misses, 1u);
+}
@@ -3,15 +3,7 @@
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
-template <typename T, std::size_t = 0>
-class Allocator {
- public:
-  static T* Allocate(const size_t n = 1) {
-    return reinterpret_cast<T*>(malloc(sizeof(T) * n));
-  }
-
-  static void Deallocate(void* ptr) { free(ptr); }
-};
+#include "test_allocator.h"
 
 class PoolTest : public ::testing::Test {
  protected:
@@ -98,3 +90,30 @@ TEST_F(PoolTest, Updates) {
 
   CheckContent();
 }
+
+TEST(IndexPool, LazyInit) {
+  using Pool = kernel::mm::IndexPool<size_t>;
+  std::vector<Pool::IndexData> list(16, Pool::IndexData{0xDEADBEEF});
+  Pool pool(list.data(), list.size());
+
+  // the index list is not touched until the first deallocation
+  for (auto& item : list) {
+    EXPECT_EQ(item.next, 0xDEADBEEFu);
+  }
+
+  for (size_t i = 0; i < 8; ++i) {
+    EXPECT_EQ(pool.Allocate(), i);
+  }
+
+  pool.Deallocate(3);
+  pool.Deallocate(5);
+  EXPECT_EQ(pool.Allocate(), 5u);
+  EXPECT_EQ(pool.Allocate(), 3u);
+  EXPECT_EQ(pool.Allocate(), 8u);
+
+  while (pool.FreeSlots() != 0) {
+    EXPECT_NE(pool.Allocate(), Pool::kNoIndex);
+  }
+
+  EXPECT_EQ(pool.Allocate(), Pool::kNoIndex);
+}
@@ -0,0 +1,159 @@
+#include "kernel/mm/physical_allocator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+template <typename T, std::size_t = 0>
+class PageAllocator {
+ public:
+  static constexpr std::size_t kPageSize =
+      kernel::mm::PageSizeInfo<kernel::mm::KERNEL_PAGE_SIZE>::in_bytes;
+
+  static T* Allocate() {
+    pages++;
+    return reinterpret_cast<T*>(aligned_alloc(kPageSize, kPageSize));
+  }
+
+  static void Deallocate(T* ptr) {
+    pages--;
+    free(ptr);
+  }
+
+  static inline std::size_t pages = 0;
+};
+
+struct Object {
+  uint64_t a;
+  uint64_t b;
+};
+
+using Slab = kernel::mm::PageSlabAllocator<Object, 0, PageAllocator>;
+using SlabPages = PageAllocator<Slab::Node>;
+
+class SlabAllocatorTest : public ::testing::Test {
+ protected:
+  ~SlabAllocatorTest() {
+    for (auto object : objects) {
+      Slab::Deallocate(object);
+    }
+  }
+
+  void New(std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+      Object* object = Slab::Allocate();
+      ASSERT_NE(object, nullptr);
+      object->a = reinterpret_cast<uint64_t>(object);
+      objects.push_back(object);
+    }
+  }
+
+  std::vector<Object*> objects;
+};
+
+TEST_F(SlabAllocatorTest, OwnerByAddress) {
+  New(Slab::Node::kPoolSize * 3);
+  EXPECT_EQ(SlabPages::pages, 3u);
+
+  std::set<Slab::Node*> nodes;
+  for (auto object : objects) {
+    auto node = Slab::NodeOf(object);
+    EXPECT_TRUE(node->pool.IsRelated(object));
+    nodes.insert(node);
+  }
+
+  EXPECT_EQ(nodes.size(), 3u);
+}
+
+TEST_F(SlabAllocatorTest, ReleaseEmptySlabs) {
+  New(Slab::Node::kPoolSize * 4);
+  EXPECT_EQ(SlabPages::pages, 4u);
+
+  for (auto object : objects) {
+    EXPECT_EQ(object->a, reinterpret_cast<uint64_t>(object));
+    Slab::Deallocate(object);
+  }
+  objects.clear();
+
+  // empty slabs are kept for the next allocations
+  constexpr auto kLimit = kernel::mm::SlabConfig<Object>::kEmptySlabLimit;
+  EXPECT_EQ(SlabPages::pages, kLimit);
+
+  New(Slab::Node::kPoolSize * kLimit);
+  EXPECT_EQ(SlabPages::pages, kLimit);
+}
+
+TEST_F(SlabAllocatorTest, Reclaim) {
+  New(Slab::Node::kPoolSize * 3);
+  for (auto object : objects) {
+    Slab::Deallocate(object);
+  }
+  objects.clear();
+
+  EXPECT_EQ(kernel::mm::PageSlabAllocatorBase::Reclaim(),
+            kernel::mm::SlabConfig<Object>::kEmptySlabLimit);
+  EXPECT_EQ(SlabPages::pages, 0u);
+  EXPECT_EQ(Slab::Stats().slabs, 0u);
+}
+
+TEST_F(SlabAllocatorTest, Statistics) {
+  New(Slab::Node::kPoolSize + 1);
+
+  const auto& stats = Slab::Stats();
+  EXPECT_EQ(stats.object_size, sizeof(Object));
+  EXPECT_EQ(stats.slabs, 2u);
+  EXPECT_EQ(stats.objects, Slab::Node::kPoolSize + 1);
+  EXPECT_EQ(stats.WastedBytes(),
+            (2 * SlabPages::kPageSize) - (stats.objects * sizeof(Object)));
+}
+
+TEST_F(SlabAllocatorTest, ReuseFreedSlots) {
+  New(Slab::Node::kPoolSize * 2);
+
+  auto object = objects[3];
+  Slab::Deallocate(object);
+  objects.erase(objects.begin() + 3);
+
+  New(1);
+  EXPECT_EQ(objects.back(), object);
+  EXPECT_EQ(SlabPages::pages, 2u);
+}
+
+// Free finds the slab by masking the address whatever the number of live
+// objects, latency is only printed. Run with --gtest_also_run_disabled_tests
+TEST_F(SlabAllocatorTest, DISABLED_FreeLatencyBenchmark) {
+  constexpr std::size_t kSamples = 1000;
+  std::mt19937 random(42);
+
+  for (std::size_t live : {1000, 10000, 100000}) {
+    New(live - objects.size());
+
+    double best = 0;
+    for (std::size_t round = 0; round < 5; ++round) {
+      std::shuffle(objects.begin(), objects.end(), random);
+      std::vector<Object*> victims(objects.end() - kSamples, objects.end());
+      objects.resize(objects.size() - kSamples);
+
+      auto begin = std::chrono::steady_clock::now();
+      for (auto object : victims) {
+        Slab::Deallocate(object);
+      }
+      auto end = std::chrono::steady_clock::now();
+
+      New(kSamples);
+
+      double ns = std::chrono::duration<double, std::nano>(end - begin).count() /
+                  kSamples;
+      best = (round == 0) ? ns : std::min(best, ns);
+    }
+
+    std::cout << "live objects: " << live << " free: " << best << " ns"
+              << std::endl;
+  }
+}
@@ -0,0 +1,18 @@
+#ifndef TEST_KERNEL_MM_TEST_ALLOCATOR_H_
+#define TEST_KERNEL_MM_TEST_ALLOCATOR_H_
+
+#include <cstddef>
+#include <cstdlib>
+
+// Pool metadata allocator backed by the host heap
+template <typename T, std::size_t = 0>
+class Allocator {
+ public:
+  static T* Allocate(const size_t n = 1) {
+    return reinterpret_cast<T*>(malloc(sizeof(T) * n));
+  }
+
+  static void Deallocate(void* ptr) { free(ptr); }
+};
+
+#endif  // TEST_KERNEL_MM_TEST_ALLOCATOR_H_
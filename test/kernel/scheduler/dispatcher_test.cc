@@ -0,0 +1,125 @@
+#include "kernel/scheduler/dispatcher.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace kernel {
+namespace scheduler {
+
+struct TickTask {
+  TickTask* next = nullptr;
+  size_t core = 0;
+  size_t priority = KERNEL_DEFAULT_PRIORITY;
+
+  const char* Name() { return "task"; }
+};
+
+struct TickLock {
+  static uint64_t SaveIrq() { return 0; }
+  static void RestoreIrq(const uint64_t) {}
+
+  void Lock() {}
+  void Unlock() {}
+};
+
+using Dispatch =
+    Dispatcher<TickTask, hal::MutexBase<TickLock>, 1, KERNEL_PRIORITY_LEVELS>;
+
+// wake from another core queues the task without an immediate preemption
+constexpr size_t kOtherCore = 1;
+
+class DispatcherTest : public ::testing::Test {
+ protected:
+  void Run(TickTask& task) {
+    dispatch.Add(task);
+    dispatch.Tick(0);
+    ASSERT_EQ(dispatch.Next(0), &task);
+  }
+
+  void Ticks(const size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      dispatch.Tick(0);
+    }
+  }
+
+  Dispatch dispatch;
+};
+
+TEST_F(DispatcherTest, HigherLevelPreemptsInOneTick) {
+  TickTask low, high;
+  high.priority = (low.priority - 1);
+  Run(low);
+
+  EXPECT_TRUE(dispatch.Wake(high, kOtherCore));
+  EXPECT_EQ(dispatch.Next(0), &low);
+
+  dispatch.Tick(0);
+  EXPECT_EQ(dispatch.Current(0), &low);
+  EXPECT_EQ(dispatch.Next(0), &high);
+  EXPECT_EQ(dispatch.Left(0), TimeSlice(high.priority));
+}
+
+TEST_F(DispatcherTest, WakePreemptsOwnCore) {
+  TickTask low, same, high;
+  high.priority = (low.priority - 1);
+  Run(low);
+
+  EXPECT_FALSE(dispatch.Wake(same, 0));
+  EXPECT_EQ(dispatch.Next(0), &low);
+
+  EXPECT_FALSE(dispatch.Wake(high, 0));
+  EXPECT_EQ(dispatch.Next(0), &high);
+}
+
+TEST_F(DispatcherTest, ExpiredSliceRotatesOnlyWithWaiters) {
+  TickTask first, second;
+  const size_t slice = TimeSlice(first.priority);
+  ASSERT_GT(slice, 1u);
+  Run(first);
+
+  // alone on its level, the slice is renewed
+  Ticks(slice * 3);
+  EXPECT_EQ(dispatch.Next(0), &first);
+  EXPECT_GT(dispatch.Left(0), 0u);
+
+  // lower level does not take an expired slice
+  TickTask lower;
+  lower.priority = (first.priority + 1);
+  dispatch.Wake(lower, kOtherCore);
+  Ticks(slice * 3);
+  EXPECT_EQ(dispatch.Next(0), &first);
+
+  dispatch.Wake(second, kOtherCore);
+  Ticks(dispatch.Left(0) - 1);
+  EXPECT_EQ(dispatch.Next(0), &first);
+
+  dispatch.Tick(0);
+  EXPECT_EQ(dispatch.Next(0), &second);
+  EXPECT_EQ(dispatch.Left(0), slice);
+
+  Ticks(slice);
+  EXPECT_EQ(dispatch.Next(0), &first);
+}
+
+TEST_F(DispatcherTest, RealTimeSliceZeroNeverExpires) {
+  ASSERT_EQ(KERNEL_RT_TIME_SLICE, 0u);
+
+  TickTask rt, same, high;
+  rt.priority = (KERNEL_RT_PRIORITY_LEVELS - 1);
+  same.priority = rt.priority;
+  high.priority = (rt.priority - 1);
+  Run(rt);
+  dispatch.Wake(same, kOtherCore);
+
+  Ticks(KERNEL_TIME_SLICE_MAX * 100);
+  EXPECT_EQ(dispatch.Next(0), &rt);
+  EXPECT_EQ(dispatch.Left(0), 0u);
+
+  // only a higher level takes the core
+  dispatch.Wake(high, kOtherCore);
+  dispatch.Tick(0);
+  EXPECT_EQ(dispatch.Next(0), &high);
+}
+
+}  // namespace scheduler
+}  // namespace kernel
@@ -0,0 +1,29 @@
+#include "kernel/scheduler/priority.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace kernel {
+namespace scheduler {
+
+TEST(Priority, RealTime) {
+  EXPECT_TRUE(IsRealTime(0));
+  EXPECT_TRUE(IsRealTime(KERNEL_RT_PRIORITY_LEVELS - 1));
+  EXPECT_FALSE(IsRealTime(KERNEL_RT_PRIORITY_LEVELS));
+  EXPECT_FALSE(IsRealTime(KERNEL_DEFAULT_PRIORITY));
+  EXPECT_EQ(TimeSlice(0), KERNEL_RT_TIME_SLICE);
+}
+
+TEST(Priority, TimeSlice) {
+  EXPECT_EQ(TimeSlice(KERNEL_RT_PRIORITY_LEVELS), KERNEL_TIME_SLICE_MAX);
+  EXPECT_EQ(TimeSlice(KERNEL_PRIORITY_LEVELS - 1), KERNEL_TIME_SLICE_MIN);
+
+  // lower level never gets longer slice
+  for (size_t i = KERNEL_RT_PRIORITY_LEVELS + 1; i < KERNEL_PRIORITY_LEVELS;
+       ++i) {
+    EXPECT_LE(TimeSlice(i), TimeSlice(i - 1));
+  }
+}
+
+}  // namespace scheduler
+}  // namespace kernel
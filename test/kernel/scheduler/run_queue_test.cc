@@ -0,0 +1,142 @@
+#include "kernel/scheduler/run_queue.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace kernel {
+namespace scheduler {
+
+struct FakeTask {
+  FakeTask* next = nullptr;
+  size_t core = 0;
+  size_t priority = 10;
+};
+
+// counts held locks, each queue operation takes exactly one
+struct FakeLock {
+  static size_t held;
+
+  static uint64_t SaveIrq() { return 0; }
+  static void RestoreIrq(const uint64_t) {}
+
+  void Lock() { held++; }
+  void Unlock() { held--; }
+};
+
+size_t FakeLock::held = 0;
+
+using Queue = RunQueue<FakeTask, hal::MutexBase<FakeLock>, 64>;
+using Queues = RunQueues<FakeTask, hal::MutexBase<FakeLock>, 4, 64>;
+
+TEST(RunQueue, Fifo) {
+  Queue queue;
+  FakeTask tasks[3];
+  for (auto& task : tasks) {
+    queue.Push(task);
+  }
+
+  EXPECT_EQ(queue.Count(), 3u);
+  EXPECT_EQ(queue.Pop(), &tasks[0]);
+  queue.Push(tasks[0]);
+  EXPECT_EQ(queue.Pop(), &tasks[1]);
+  EXPECT_EQ(queue.Pop(), &tasks[2]);
+  EXPECT_EQ(queue.Pop(), &tasks[0]);
+  EXPECT_EQ(queue.Pop(), nullptr);
+  EXPECT_EQ(queue.Count(), 0u);
+  EXPECT_EQ(FakeLock::held, 0u);
+}
+
+TEST(RunQueue, HighestFirst) {
+  Queue queue;
+  FakeTask low, high, top, bottom;
+  low.priority = 40;
+  high.priority = 3;
+  top.priority = 0;
+  bottom.priority = 63;
+  queue.Push(low);
+  queue.Push(bottom);
+  queue.Push(high);
+  EXPECT_EQ(queue.Top(), 3u);
+
+  queue.Push(top);
+  EXPECT_EQ(queue.Top(), 0u);
+  EXPECT_EQ(queue.Pop(), &top);
+  EXPECT_EQ(queue.Pop(), &high);
+  EXPECT_EQ(queue.Top(), 40u);
+  EXPECT_EQ(queue.Pop(), &low);
+  EXPECT_EQ(queue.Pop(), &bottom);
+  EXPECT_EQ(queue.Top(), 64u);
+  EXPECT_EQ(queue.Count(), 0u);
+}
+
+TEST(RunQueue, PushFront) {
+  Queue queue;
+  FakeTask tasks[3];
+  queue.Push(tasks[0]);
+  queue.Push(tasks[1]);
+  queue.PushFront(tasks[2]);
+
+  EXPECT_EQ(queue.Pop(), &tasks[2]);
+  EXPECT_EQ(queue.Pop(), &tasks[0]);
+  EXPECT_EQ(queue.Pop(), &tasks[1]);
+
+  // level left empty by pop gets a valid tail
+  queue.PushFront(tasks[0]);
+  queue.Push(tasks[1]);
+  EXPECT_EQ(queue.Pop(), &tasks[0]);
+  EXPECT_EQ(queue.Pop(), &tasks[1]);
+  EXPECT_EQ(queue.Pop(), nullptr);
+}
+
+TEST(RunQueues, AddToLeastLoaded) {
+  Queues queues;
+  FakeTask tasks[6];
+  for (auto& task : tasks) {
+    queues.Add(task);
+  }
+
+  EXPECT_EQ(tasks[3].core, 3u);
+  EXPECT_EQ(tasks[4].core, 0u);
+  EXPECT_EQ(tasks[5].core, 1u);
+  EXPECT_EQ(queues[0].Count(), 2u);
+  EXPECT_EQ(queues[2].Count(), 1u);
+}
+
+TEST(RunQueues, WakeOnLastCore) {
+  Queues queues;
+  FakeTask task;
+  task.core = 2;
+
+  EXPECT_FALSE(queues.Wake(task, 2));
+  EXPECT_EQ(queues.Next(2), &task);
+  EXPECT_TRUE(queues.Wake(task, 0));
+  EXPECT_EQ(queues[2].Count(), 1u);
+}
+
+TEST(RunQueues, StealFromBusiest) {
+  Queues queues;
+  FakeTask tasks[4];
+  tasks[0].core = 1;
+  for (size_t i = 1; i < 4; ++i) {
+    tasks[i].core = 2;
+  }
+  for (auto& task : tasks) {
+    queues.Wake(task, 0);
+  }
+
+  // own queue goes first, then the oldest task of the longest queue
+  EXPECT_EQ(queues.Next(1), &tasks[0]);
+  EXPECT_EQ(queues.Next(0), &tasks[1]);
+  EXPECT_EQ(tasks[1].core, 0u);
+  EXPECT_EQ(queues.Next(1), &tasks[2]);
+  EXPECT_EQ(tasks[2].core, 1u);
+  EXPECT_EQ(queues[2].Count(), 1u);
+}
+
+TEST(RunQueues, NothingToSteal) {
+  Queues queues;
+  EXPECT_EQ(queues.Next(3), nullptr);
+}
+
+}  // namespace scheduler
+}  // namespace kernel
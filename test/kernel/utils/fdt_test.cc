@@ -0,0 +1,259 @@
+#include "kernel/utils/fdt.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "kernel/cpu_map.h"
+#include "kernel/mm/memory_map.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace utils {
+
+// Builds big endian device tree blob
+class FdtBuilder {
+ public:
+  FdtBuilder() { reserves_.push_back(0); reserves_.push_back(0); }
+
+  void Reserve(uint64_t base, uint64_t length) {
+    reserves_.insert(reserves_.end() - 2, {base, length});
+  }
+
+  void BeginNode(const std::string& name) {
+    Token(1);
+    String(name);
+  }
+
+  void EndNode() { Token(2); }
+
+  void StringProp(const std::string& name, const std::string& value) {
+    Token(3);
+    Token(value.size() + 1);
+    Token(strings_.size());
+    strings_ += name;
+    strings_.push_back('\0');
+    String(value);
+  }
+
+  void Prop(const std::string& name, const std::vector<uint32_t>& cells) {
+    Token(3);
+    Token(cells.size() * 4);
+    Token(strings_.size());
+    strings_ += name;
+    strings_.push_back('\0');
+    for (auto cell : cells) {
+      Token(cell);
+    }
+  }
+
+  std::vector<uint32_t> Build() {
+    Token(9);
+    std::vector<uint32_t> blob(10);
+    blob[4] = Be(blob.size() * 4);
+    for (auto value : reserves_) {
+      blob.push_back(Be(value >> 32));
+      blob.push_back(Be(value));
+    }
+
+    blob[2] = Be(blob.size() * 4);
+    blob[9] = Be(struct_.size() * 4);
+    blob.insert(blob.end(), struct_.begin(), struct_.end());
+    blob[3] = Be(blob.size() * 4);
+    strings_.resize((strings_.size() + 3) & ~3);
+    for (size_t i = 0; i < strings_.size(); i += 4) {
+      uint32_t word = 0;
+      std::memcpy(&word, strings_.c_str() + i, 4);
+      blob.push_back(word);
+    }
+
+    blob[0] = Be(Fdt::kMagic);
+    blob[1] = Be(blob.size() * 4);
+    blob[5] = Be(17);
+    return blob;
+  }
+
+ private:
+  static uint32_t Be(uint32_t value) { return __builtin_bswap32(value); }
+  void Token(uint32_t value) { struct_.push_back(Be(value)); }
+
+  void String(const std::string& value) {
+    auto bytes = value.size() + 1;
+    for (size_t i = 0; i < bytes; i += 4) {
+      uint32_t word = 0;
+      std::memcpy(&word, value.c_str() + i, std::min<size_t>(4, bytes - i));
+      struct_.push_back(word);
+    }
+  }
+
+  std::vector<uint64_t> reserves_;
+  std::vector<uint32_t> struct_;
+  std::string strings_;
+};
+
+using Range = std::pair<uint64_t, uint64_t>;
+
+class FdtTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    builder.BeginNode("");
+    builder.Prop("#address-cells", {1});
+    builder.Prop("#size-cells", {1});
+    builder.BeginNode("memory@0");
+    builder.Prop("device_type", {0x6d656d6f});
+    builder.Prop("reg", {0x0, 0x3C000000});
+    builder.EndNode();
+    builder.BeginNode("reserved-memory");
+    builder.Prop("#address-cells", {2});
+    builder.Prop("#size-cells", {2});
+    builder.BeginNode("buffer@1000000");
+    builder.Prop("reg", {0x0, 0x1000000, 0x0, 0x200000});
+    builder.EndNode();
+    builder.EndNode();
+    builder.EndNode();
+    builder.Reserve(0x0, 0x1000);
+  }
+
+  FdtBuilder builder;
+};
+
+TEST_F(FdtTest, Invalid) {
+  uint32_t blob[16] = {};
+  EXPECT_FALSE(Fdt(blob).Valid());
+  EXPECT_FALSE(Fdt(nullptr).Valid());
+}
+
+TEST_F(FdtTest, Memory) {
+  auto blob = builder.Build();
+  Fdt fdt(blob.data());
+  ASSERT_TRUE(fdt.Valid());
+  EXPECT_EQ(fdt.TotalSize(), blob.size() * 4);
+
+  std::vector<Range> ranges;
+  fdt.ForEachMemory([&](uint64_t base, uint64_t length) {
+    ranges.push_back({base, length});
+  });
+
+  EXPECT_THAT(ranges, ::testing::ElementsAre(Range{0x0, 0x3C000000}));
+}
+
+TEST_F(FdtTest, Reserved) {
+  auto blob = builder.Build();
+  std::vector<Range> ranges;
+  Fdt(blob.data()).ForEachReserved([&](uint64_t base, uint64_t length) {
+    ranges.push_back({base, length});
+  });
+
+  EXPECT_THAT(ranges, ::testing::ElementsAre(Range{0x0, 0x1000},
+                                             Range{0x1000000, 0x200000}));
+}
+
+TEST_F(FdtTest, TruncatedBlob) {
+  auto blob = builder.Build();
+  const uint32_t structs = __builtin_bswap32(blob[2]);
+
+  // struct size points past the blob, totalsize ends inside memory reg
+  blob[9] = __builtin_bswap32(0xFFFFFFF0);
+  blob[1] = __builtin_bswap32(structs + (21 * 4));
+  Fdt fdt(blob.data());
+  ASSERT_TRUE(fdt.Valid());
+
+  size_t count = 0;
+  fdt.ForEachMemory([&](uint64_t, uint64_t) { count++; });
+  EXPECT_EQ(count, 0u);
+
+  // totalsize ends inside the reservation block
+  blob[1] = __builtin_bswap32(40 + 24);
+  fdt.ForEachReserved([&](uint64_t, uint64_t) { count++; });
+  EXPECT_EQ(count, 1u);
+}
+
+TEST_F(FdtTest, MemoryMapReserveFull) {
+  kernel::mm::MemoryMap map;
+  map.Add({0x0, 0x100000, kernel::mm::MemoryType::RAM});
+  for (size_t i = 1; i < kernel::mm::MemoryMap::kMaxRanges; ++i) {
+    map.Add({(0x100000 * i), 0x1000, kernel::mm::MemoryType::DEVICE});
+  }
+
+  EXPECT_FALSE(map.Reserve(0x1000, 0x1000));
+  EXPECT_EQ(map.Find(kernel::mm::MemoryType::RAM)->length, 0x1000u);
+  EXPECT_EQ(map.Dropped(), 0xFE000u);
+  EXPECT_TRUE(map.Reserve(0x0, 0x1000));
+}
+
+TEST_F(FdtTest, MemoryMap) {
+  using kernel::mm::MemoryType;
+
+  auto blob = builder.Build();
+  auto map = kernel::mm::MemoryMap::FromFdt(Fdt(blob.data()));
+
+  std::vector<Range> ram;
+  const kernel::mm::MemoryRange* vc_ram = nullptr;
+  for (auto& range : map) {
+    if (MemoryType::RAM == range.type) {
+      ram.push_back({range.base, range.length});
+    } else if (MemoryType::VC_RAM == range.type) {
+      vc_ram = &range;
+    }
+  }
+
+  EXPECT_THAT(ram, ::testing::ElementsAre(Range{0x1000, 0xFFF000},
+                                          Range{0x1200000, 0x3AE00000}));
+  ASSERT_NE(vc_ram, nullptr);
+  EXPECT_EQ(vc_ram->base, 0x3C000000u);
+  EXPECT_EQ(vc_ram->End(), 0x3F000000u);
+}
+
+TEST_F(FdtTest, MemoryMapDefault) {
+  uint32_t blob[16] = {};
+  auto map = kernel::mm::MemoryMap::FromFdt(Fdt(blob));
+  EXPECT_EQ(map.Count(), kernel::mm::MemoryMap::Default().Count());
+  EXPECT_EQ(map.Find(kernel::mm::MemoryType::RAM)->length, (880ULL << 20));
+}
+
+TEST_F(FdtTest, Cpus) {
+  using arch::arm64::EnableMethod;
+
+  FdtBuilder cpus;
+  cpus.BeginNode("");
+  cpus.BeginNode("psci");
+  cpus.StringProp("method", "smc");
+  cpus.EndNode();
+  cpus.BeginNode("cpus");
+  cpus.Prop("#address-cells", {1});
+  cpus.BeginNode("cpu@0");
+  cpus.Prop("reg", {0x0});
+  cpus.StringProp("enable-method", "spin-table");
+  cpus.Prop("cpu-release-addr", {0x0, 0xd8});
+  cpus.EndNode();
+  cpus.BeginNode("cpu@1");
+  cpus.StringProp("enable-method", "psci");
+  cpus.Prop("reg", {0x1});
+  cpus.EndNode();
+  cpus.EndNode();
+  cpus.EndNode();
+  auto blob = cpus.Build();
+  Fdt fdt(blob.data());
+
+  EXPECT_TRUE(Fdt::Equal(fdt.PsciMethod(), "smc"));
+  auto map = kernel::CpuMap::FromFdt(fdt);
+  ASSERT_EQ(map.Count(), 2u);
+  EXPECT_EQ(map.begin()[0].id, 0u);
+  EXPECT_EQ(map.begin()[0].method, EnableMethod::SPIN_TABLE);
+  EXPECT_EQ(map.begin()[0].release, 0xd8u);
+  EXPECT_EQ(map.begin()[1].id, 1u);
+  EXPECT_EQ(map.begin()[1].method, EnableMethod::PSCI_SMC);
+}
+
+TEST_F(FdtTest, CpusDefault) {
+  auto blob = builder.Build();
+  EXPECT_EQ(Fdt(blob.data()).PsciMethod(), nullptr);
+
+  auto map = kernel::CpuMap::FromFdt(Fdt(blob.data()));
+  ASSERT_EQ(map.Count(), kernel::KERNEL_CPU_COUNT);
+  EXPECT_EQ(map.begin()[3].method, arch::arm64::EnableMethod::SPIN_TABLE);
+  EXPECT_EQ(map.begin()[3].release, 0xf0u);
+}
+
+}  // namespace utils
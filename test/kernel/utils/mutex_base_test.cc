@@ -0,0 +1,83 @@
+#include "kernel/hal/mutex_base.h"
+
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace kernel {
+namespace hal {
+
+// records the order of lock and IRQ mask operations
+struct FakeLock {
+  static inline std::vector<const char*> calls;
+  static inline uint64_t irq = 0;
+
+  static uint64_t SaveIrq() {
+    calls.push_back("save");
+    const uint64_t flags = irq;
+    irq = 1;
+    return flags;
+  }
+
+  static void RestoreIrq(const uint64_t flags) {
+    calls.push_back("restore");
+    irq = flags;
+  }
+
+  void Lock() { calls.push_back("lock"); }
+  void Unlock() { calls.push_back("unlock"); }
+};
+
+class MutexBaseTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    FakeLock::calls.clear();
+    FakeLock::irq = 0;
+  }
+
+  MutexBase<FakeLock> mutex;
+};
+
+TEST_F(MutexBaseTest, LockGuard) {
+  { LockGuard<MutexBase<FakeLock>> guard(mutex); }
+  EXPECT_THAT(FakeLock::calls,
+              ::testing::ElementsAre(::testing::StrEq("lock"),
+                                     ::testing::StrEq("unlock")));
+}
+
+TEST_F(MutexBaseTest, IrqSaveGuard) {
+  {
+    IrqSaveGuard<MutexBase<FakeLock>> guard(mutex);
+    EXPECT_EQ(FakeLock::irq, 1u);
+  }
+  EXPECT_EQ(FakeLock::irq, 0u);
+  EXPECT_THAT(FakeLock::calls,
+              ::testing::ElementsAre(
+                  ::testing::StrEq("save"), ::testing::StrEq("lock"),
+                  ::testing::StrEq("unlock"), ::testing::StrEq("restore")));
+}
+
+TEST_F(MutexBaseTest, NestedIrqSave) {
+  // inner guard keeps IRQ masked, the outer one unmasks it
+  {
+    IrqSaveGuard<MutexBase<FakeLock>> outer(mutex);
+    { IrqSaveGuard<MutexBase<FakeLock>> inner(mutex); }
+    EXPECT_EQ(FakeLock::irq, 1u);
+  }
+  EXPECT_EQ(FakeLock::irq, 0u);
+}
+
+TEST_F(MutexBaseTest, IrqGuard) {
+  {
+    IrqGuard<MutexBase<FakeLock>> guard;
+    EXPECT_EQ(FakeLock::irq, 1u);
+  }
+  EXPECT_EQ(FakeLock::irq, 0u);
+  EXPECT_THAT(FakeLock::calls,
+              ::testing::ElementsAre(::testing::StrEq("save"),
+                                     ::testing::StrEq("restore")));
+}
+
+}  // namespace hal
+}  // namespace kernel